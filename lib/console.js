@@ -28,10 +28,29 @@ export function Console(opts = {}) {
     compact: false,
     customInspect: true
   };
-  let options = {
+  let compiled;
+
+  /* edits of the options drop the compiled copy, nested objects like hideKeys have to be assigned again */
+  const watchOptions = obj =>
+    new Proxy(obj, {
+      set(target, prop, value) {
+        compiled = undefined;
+        return Reflect.set(target, prop, value);
+      },
+      defineProperty(target, prop, desc) {
+        compiled = undefined;
+        return Reflect.defineProperty(target, prop, desc);
+      },
+      deleteProperty(target, prop) {
+        compiled = undefined;
+        return Reflect.deleteProperty(target, prop);
+      }
+    });
+
+  let options = watchOptions({
     ...defaultOptions,
     ...(opts.inspectOptions ?? {})
-  };
+  });
 
   let c = globalThis.console;
 
@@ -45,16 +64,16 @@ export function Console(opts = {}) {
 
   const outputFunction = out => (...args) => out.puts(args.join(' ') + '\n');
 
-  const inspectFunction = (...args) => {
-    let [obj, opts] = args;
-    if(args.length == 0) obj = newcons;
-    return inspect(obj, ConsoleOptions.merge(newcons.options, opts));
+  /* the console options are parsed once, until they or console.options are changed */
+  const compiledOptions = () => {
+    if(!compiled) compiled = inspect.compileOptions ? inspect.compileOptions(options) : options;
+    return compiled;
   };
 
-  const logFunction = output =>
+  const logFunction = (output, file) =>
     function(...args) {
-      let tempOpts = new ConsoleOptions(newcons.options);
-      let acc = tempOpts.prefix ? [tempOpts.prefix] : [];
+      let tempOpts;
+      let acc = newcons.options.prefix ? [newcons.options.prefix] : [];
       let i = 0;
 
       for(let arg of args) {
@@ -64,12 +83,21 @@ export function Console(opts = {}) {
               acc.push('null');
               continue;
             } else if(arg.merge === ConsoleOptions.prototype.merge) {
-              tempOpts.merge(arg);
+              tempOpts = (tempOpts ?? new ConsoleOptions(newcons.options)).merge(arg);
               continue;
             }
           }
+          let opts = tempOpts ? ConsoleOptions.merge(newcons.options, tempOpts) : compiledOptions();
+          if(typeof arg == 'object' && file && inspect.write) {
+            /* render objects straight to the file, without an intermediate string */
+            file.puts(acc.concat(['']).join(' '));
+            file.flush();
+            inspect.write(file.fileno(), arg, opts);
+            acc = [''];
+            continue;
+          }
           if(i++ >= 0) {
-            acc.push(typeof arg == 'string' ? arg : inspectFunction(arg, tempOpts));
+            acc.push(typeof arg == 'string' ? arg : inspect(arg, opts));
             continue;
           }
           acc.push(arg);
@@ -81,7 +109,15 @@ export function Console(opts = {}) {
       return output(...acc);
     };
 
-  newcons.options = options;
+  Object.defineProperty(newcons, 'options', {
+    get: () => options,
+    set(value) {
+      options = watchOptions(value);
+      compiled = undefined;
+    },
+    enumerable: true,
+    configurable: true
+  });
 
   globalThis.console = newcons;
 
@@ -97,7 +133,7 @@ export function Console(opts = {}) {
       ['warn', std.err],
       ['debug', std.out]
     ]) {
-      if(cons[method] === undefined) fns[method] = logFunction(outputFunction(output));
+      if(cons[method] === undefined) fns[method] = logFunction(outputFunction(output), output);
     }
     return Object.assign(cons, fns);
   }
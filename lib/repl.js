@@ -118,6 +118,8 @@ import inspect from 'inspect';
   var show_time = false;
   var show_colors = true;
   var eval_time = 0;
+  /* rest of the last result, when it didn't fit on the screen */
+  var result_cursor;
 
   var mexpr = '';
   var level = 0;
@@ -135,6 +137,7 @@ import inspect from 'inspect';
   var term_fd;
   var term_read_buf;
   var term_width;
+  var term_height;
   /* current X position of the cursor in the terminal */
   var term_cursor_x = 0;
 
@@ -144,10 +147,11 @@ import inspect from 'inspect';
 
     /* get the terminal size */
     term_width = 80;
+    term_height = 25;
     if(os.isatty(term_fd)) {
       if(os.ttyGetWinSize) {
         tab = os.ttyGetWinSize(term_fd);
-        if(tab) term_width = tab[0];
+        if(tab) [term_width, term_height] = tab;
       }
       if(os.ttySetRaw) {
         /* set the TTY to raw mode */
@@ -1066,6 +1070,9 @@ import inspect from 'inspect';
       hex_mode = false;
     } else if(cmd === 't') {
       show_time = !show_time;
+    } else if(cmd === 'm') {
+      if(result_cursor) print_page();
+      return false;
     } else if(has_bignum && cmd === 'p') {
       param = expr
         .substring(cmd.length + 1)
@@ -1180,6 +1187,7 @@ import inspect from 'inspect';
         '\\t         ' +
         sel(show_time) +
         'toggle timing display\n' +
+        '\\m          show more of the last result\n' +
         '\\clear      clear the terminal\n'
     );
     if(has_jscalc) {
@@ -1204,6 +1212,15 @@ import inspect from 'inspect';
     }
   }
 
+  function print_page() {
+    let lines = result_cursor.read(Math.max(1, term_height - 2));
+    std.puts(colors[styles.result]);
+    for(let line of lines) std.puts(line + '\n');
+    std.puts(colors.none);
+    if(result_cursor.done) result_cursor = undefined;
+    else std.puts('-- more, type \\m --\n');
+  }
+
   function eval_and_print(expr) {
     var result;
 
@@ -1213,10 +1230,9 @@ import inspect from 'inspect';
       /* eval as a script */
       result = std.evalScript(expr, { backtrace_barrier: true });
       eval_time = new Date().getTime() - now;
-      std.puts(colors[styles.result]);
-      std.puts(inspect(result));
-      std.puts('\n');
-      std.puts(colors.none);
+      /* render only as much of the result as fits on the screen */
+      result_cursor = inspect.cursor(result);
+      print_page();
       /* set the last result */
       g._ = result;
     } catch(error) {
@@ -6,28 +6,80 @@
 #include "pointer.h"
 #include "utils.h"
 
+typedef struct {
+  JSAtom key; /* the path string */
+  uint32_t n, stamp;
+  JSAtom* atoms;
+} PointerCacheEntry;
+
+struct PointerCache {
+  uint32_t clock;
+  PointerCacheEntry entries[POINTER_CACHE_SIZE];
+};
+
+extern JSClassID js_pointer_cache_class_id;
+
 void
 pointer_reset(Pointer* ptr, JSContext* ctx) {
   size_t i;
 
   if(ptr->atoms) {
     for(i = 0; i < ptr->n; i++) JS_FreeAtom(ctx, ptr->atoms[i]);
-    js_free(ctx, ptr->atoms);
+    if(ptr->atoms != ptr->inline_atoms)
+      js_free(ctx, ptr->atoms);
     ptr->atoms = 0;
+    ptr->capacity = 0;
+  }
+  if(ptr->slots) {
+    js_free(ctx, ptr->slots);
+    ptr->slots = 0;
+    ptr->nslots = 0;
   }
   ptr->n = 0;
 }
 
+/* grows the atom buffer to hold at least 'size' atoms, doubling it once the inline buffer is exhausted */
+int
+pointer_reserve(Pointer* ptr, JSContext* ctx, size_t size) {
+  JSAtom* atoms;
+  size_t capacity;
+
+  if(size <= ptr->capacity)
+    return 0;
+
+  if(size <= POINTER_INLINE_ATOMS && !ptr->atoms) {
+    ptr->atoms = ptr->inline_atoms;
+    ptr->capacity = POINTER_INLINE_ATOMS;
+    return 0;
+  }
+
+  capacity = max_num(ptr->capacity * 2, size);
+
+  if(ptr->atoms == ptr->inline_atoms) {
+    if(!(atoms = js_malloc(ctx, sizeof(JSAtom) * capacity)))
+      return -1;
+    memcpy(atoms, ptr->inline_atoms, sizeof(JSAtom) * ptr->n);
+  } else if(!(atoms = js_realloc(ctx, ptr->atoms, sizeof(JSAtom) * capacity))) {
+    return -1;
+  }
+
+  ptr->atoms = atoms;
+  ptr->capacity = capacity;
+  return 0;
+}
+
 void
 pointer_copy(Pointer* dst, Pointer* src, JSContext* ctx) {
+  size_t i;
+
   if(dst->n)
     pointer_reset(dst, ctx);
 
-  if((dst->atoms = js_mallocz(ctx, sizeof(JSAtom) * src->n))) {
-    size_t i;
-    dst->n = src->n;
-    for(i = 0; i < src->n; i++) dst->atoms[i] = JS_DupAtom(ctx, src->atoms[i]);
-  }
+  if(pointer_reserve(dst, ctx, src->n))
+    return;
+
+  for(i = 0; i < src->n; i++) dst->atoms[i] = JS_DupAtom(ctx, src->atoms[i]);
+  dst->n = src->n;
 }
 
 void
@@ -38,10 +90,10 @@ pointer_truncate(Pointer* ptr, JSContext* ctx, size_t size) {
   }
   if(ptr->atoms) {
     size_t i;
-    for(i = ptr->n - 1; i >= size; i--) JS_FreeAtom(ctx, ptr->atoms[i]);
+    for(i = size; i < ptr->n; i++) JS_FreeAtom(ctx, ptr->atoms[i]);
 
-    ptr->atoms = js_realloc(ctx, ptr->atoms, sizeof(JSAtom) * size);
-    ptr->n = size;
+    if(ptr->n > size)
+      ptr->n = size;
   }
 }
 
@@ -139,7 +191,7 @@ pointer_parse(Pointer* ptr, JSContext* ctx, const char* str, size_t len) {
     else
       atom = JS_NewAtomLen(ctx, &str[start], n);
 
-    pointer_push(ptr, atom);
+    pointer_push(ptr, ctx, atom);
 
     str += delim;
     len -= delim;
@@ -154,18 +206,21 @@ pointer_parse(Pointer* ptr, JSContext* ctx, const char* str, size_t len) {
 
 Pointer*
 pointer_slice(Pointer* ptr, JSContext* ctx, int64_t start, int64_t end) {
-  Pointer* ret = js_mallocz(ctx, sizeof(Pointer));
+  Pointer* ret;
   int64_t i;
 
+  if(!(ret = pointer_new(ctx)))
+    return 0;
+
   start = mod_int32(start, ptr->n);
   end = mod_int32(end, ptr->n);
   if(end == 0)
     end = ptr->n;
 
-  ret->n = end - start;
-  ret->atoms = ret->n ? js_mallocz(ctx, sizeof(JSAtom) * ret->n) : 0;
-
-  for(i = start; i < end; i++) ret->atoms[i - start] = JS_DupAtom(ctx, ptr->atoms[i]);
+  if(end > start && !pointer_reserve(ret, ctx, end - start)) {
+    for(i = start; i < end; i++) ret->atoms[i - start] = JS_DupAtom(ctx, ptr->atoms[i]);
+    ret->n = end - start;
+  }
 
   return ret;
 }
@@ -190,10 +245,26 @@ pointer_deref(Pointer* ptr, JSContext* ctx, JSValueConst arg) {
   size_t i;
   JSValue obj = JS_DupValue(ctx, arg);
 
+  if(ptr->nslots < ptr->n) {
+    uint32_t* slots;
+
+    if((slots = js_realloc(ctx, ptr->slots, sizeof(uint32_t) * ptr->n))) {
+      memset(&slots[ptr->nslots], 0, sizeof(uint32_t) * (ptr->n - ptr->nslots));
+      ptr->slots = slots;
+      ptr->nslots = ptr->n;
+    }
+  }
+
   for(i = 0; i < ptr->n; i++) {
-    JSAtom atom = ptr->atoms[i]; // JS_DupAtom(ctx, ptr->atoms[i]);
+    JSValue child;
+    int ret = js_get_property_hint(ctx, obj, ptr->atoms[i], ptr->nslots >= ptr->n ? &ptr->slots[i] : 0, &child);
 
-    if(!JS_HasProperty(ctx, obj, atom)) {
+    JS_FreeValue(ctx, obj);
+
+    if(ret == -1)
+      return JS_EXCEPTION;
+
+    if(ret == 0) {
       DynBuf dbuf;
       js_dbuf_init(ctx, &dbuf);
 
@@ -204,9 +275,6 @@ pointer_deref(Pointer* ptr, JSContext* ctx, JSValueConst arg) {
       break;
     }
 
-    JSValue child = JS_GetProperty(ctx, obj, atom);
-    JS_FreeValue(ctx, obj);
-
     obj = child;
   }
   return obj;
@@ -234,13 +302,136 @@ pointer_acquire(Pointer* ptr, JSContext* ctx, JSValueConst arg) {
   return obj;
 }
 
+PointerCache*
+pointer_cache_new(JSContext* ctx) {
+  return js_mallocz(ctx, sizeof(PointerCache));
+}
+
+void
+pointer_cache_free(PointerCache* pc, JSRuntime* rt) {
+  pointer_cache_clear(pc, rt);
+  js_free_rt(rt, pc);
+}
+
+void
+pointer_cache_clear(PointerCache* pc, JSRuntime* rt) {
+  uint32_t i, j;
+
+  for(i = 0; i < POINTER_CACHE_SIZE; i++) {
+    PointerCacheEntry* entry = &pc->entries[i];
+
+    if(entry->key == JS_ATOM_NULL)
+      continue;
+
+    for(j = 0; j < entry->n; j++) JS_FreeAtomRT(rt, entry->atoms[j]);
+    js_free_rt(rt, entry->atoms);
+    JS_FreeAtomRT(rt, entry->key);
+    memset(entry, 0, sizeof(PointerCacheEntry));
+  }
+}
+
+uint32_t
+pointer_cache_size(const PointerCache* pc) {
+  uint32_t i, n = 0;
+
+  for(i = 0; i < POINTER_CACHE_SIZE; i++)
+    if(pc->entries[i].key != JS_ATOM_NULL)
+      n++;
+
+  return n;
+}
+
+/* the cache of the context, js_pointer_init() installs the Pointer.cache object as the prototype of its class */
+static PointerCache*
+pointer_cache_get(JSContext* ctx) {
+  PointerCache* pc;
+  JSValue obj;
+
+  if(!js_pointer_cache_class_id || !JS_IsRegisteredClass(JS_GetRuntime(ctx), js_pointer_cache_class_id))
+    return 0;
+
+  obj = JS_GetClassProto(ctx, js_pointer_cache_class_id);
+  pc = JS_GetOpaque(obj, js_pointer_cache_class_id);
+  JS_FreeValue(ctx, obj);
+  return pc;
+}
+
+/* looks up the path string 'key', returns the entry or, when not found, the least recently used one */
+static PointerCacheEntry*
+pointer_cache_find(PointerCache* pc, JSAtom key, BOOL* found) {
+  PointerCacheEntry *entry, *lru = &pc->entries[0];
+  uint32_t i;
+
+  for(i = 0; i < POINTER_CACHE_SIZE; i++) {
+    entry = &pc->entries[i];
+
+    if(entry->key == key) {
+      *found = TRUE;
+      return entry;
+    }
+
+    if(entry->stamp < lru->stamp)
+      lru = entry;
+  }
+
+  *found = FALSE;
+  return lru;
+}
+
+static void
+pointer_cache_store(PointerCacheEntry* entry, JSContext* ctx, JSAtom key, const JSAtom* parsed, uint32_t n) {
+  JSAtom* atoms;
+  uint32_t i;
+
+  if(!(atoms = js_malloc(ctx, sizeof(JSAtom) * (n + 1))))
+    return;
+
+  if(entry->key != JS_ATOM_NULL) {
+    for(i = 0; i < entry->n; i++) JS_FreeAtom(ctx, entry->atoms[i]);
+    js_free(ctx, entry->atoms);
+    JS_FreeAtom(ctx, entry->key);
+  }
+
+  for(i = 0; i < n; i++) atoms[i] = JS_DupAtom(ctx, parsed[i]);
+
+  entry->key = JS_DupAtom(ctx, key);
+  entry->atoms = atoms;
+  entry->n = n;
+}
+
 void
 pointer_fromstring(Pointer* ptr, JSContext* ctx, JSValueConst value) {
-  size_t len;
+  size_t len, start = ptr->n;
   const char* str;
+  PointerCache* pc = pointer_cache_get(ctx);
+  PointerCacheEntry* entry = 0;
+  JSAtom key = JS_ATOM_NULL;
+  BOOL found = FALSE;
+
+  if(pc && (key = JS_ValueToAtom(ctx, value)) != JS_ATOM_NULL) {
+    entry = pointer_cache_find(pc, key, &found);
+    entry->stamp = ++pc->clock;
+
+    if(found) {
+      uint32_t i;
+
+      if(!pointer_reserve(ptr, ctx, ptr->n + entry->n))
+        for(i = 0; i < entry->n; i++) ptr->atoms[ptr->n++] = JS_DupAtom(ctx, entry->atoms[i]);
+
+      JS_FreeAtom(ctx, key);
+      return;
+    }
+  }
+
   str = JS_ToCStringLen(ctx, &len, value);
   pointer_parse(ptr, ctx, str, len);
   js_cstring_free(ctx, str);
+
+  if(entry && ptr->n >= start)
+    pointer_cache_store(entry, ctx, key, ptr->atoms + start, ptr->n - start);
+
+  if(key != JS_ATOM_NULL)
+    JS_FreeAtom(ctx, key);
 }
 
 void
@@ -250,9 +441,9 @@ pointer_fromarray(Pointer* ptr, JSContext* ctx, JSValueConst array) {
   len = js_array_length(ctx, array);
   pointer_reset(ptr, ctx);
 
-  assert(len > 0);
+  if(pointer_reserve(ptr, ctx, len))
+    return;
 
-  ptr->atoms = js_malloc(ctx, sizeof(JSAtom) * len);
   for(i = 0; i < len; i++) {
     prop = JS_GetPropertyUint32(ctx, array, i);
     ptr->atoms[i] = JS_ValueToAtom(ctx, prop);
@@ -272,7 +463,7 @@ pointer_fromiterable(Pointer* ptr, JSContext* ctx, JSValueConst arg) {
     item = js_iterator_next(ctx, iter);
     if(item.done)
       break;
-    pointer_push(ptr, JS_ValueToAtom(ctx, item.value));
+    pointer_push(ptr, ctx, JS_ValueToAtom(ctx, item.value));
     JS_FreeValue(ctx, item.value);
   }
   JS_FreeValue(ctx, iter);
@@ -293,3 +484,147 @@ pointer_from(Pointer* ptr, JSContext* ctx, JSValueConst value, DataFunc* data) {
 
   return 1;
 }
+
+typedef struct {
+  JSAtom atom;
+  int32_t child, sibling, output;
+} PointerTrieNode;
+
+static void
+pointer_set_flatten(PointerSet* set, JSContext* ctx, const PointerTrieNode* trie, int32_t index) {
+  PointerSetNode* node;
+  uint32_t pos = vector_size(&set->nodes, sizeof(PointerSetNode));
+  int32_t child;
+
+  if(!(node = vector_emplace(&set->nodes, sizeof(PointerSetNode))))
+    return;
+
+  node->atom = trie[index].atom == JS_ATOM_NULL ? JS_ATOM_NULL : JS_DupAtom(ctx, trie[index].atom);
+  node->slot = 0;
+  node->output = trie[index].output;
+
+  for(child = trie[index].child; child != -1; child = trie[child].sibling) pointer_set_flatten(set, ctx, trie, child);
+
+  node = vector_at(&set->nodes, sizeof(PointerSetNode), pos);
+  node->end = vector_size(&set->nodes, sizeof(PointerSetNode));
+}
+
+int
+pointer_set_compile(PointerSet* set, JSContext* ctx, Pointer* const* ptrs, size_t n) {
+  Vector trie = VECTOR(ctx);
+  PointerTrieNode root = {JS_ATOM_NULL, -1, -1, -1};
+  size_t i, j;
+
+  vector_init(&set->nodes, ctx);
+  vector_init(&set->aliases, ctx);
+  set->noutputs = n;
+  set->names = 0;
+
+  vector_push(&trie, root);
+
+  for(i = 0; i < n; i++) {
+    int32_t cur = 0, *out;
+
+    for(j = 0; j < ptrs[i]->n; j++) {
+      PointerTrieNode* nodes = vector_begin(&trie);
+      int32_t child;
+
+      for(child = nodes[cur].child; child != -1; child = nodes[child].sibling)
+        if(nodes[child].atom == ptrs[i]->atoms[j])
+          break;
+
+      if(child == -1) {
+        PointerTrieNode node = {ptrs[i]->atoms[j], -1, -1, -1};
+        int32_t *link = &nodes[cur].child;
+
+        /* append, so siblings keep the order of the pointers */
+        while(*link != -1) link = &nodes[*link].sibling;
+
+        child = vector_size(&trie, sizeof(PointerTrieNode));
+        *link = child;
+        vector_push(&trie, node);
+      }
+      cur = child;
+    }
+
+    out = &((PointerTrieNode*)vector_begin(&trie))[cur].output;
+
+    if(*out == -1) {
+      *out = i;
+    } else {
+      int32_t alias[2] = {*out, i};
+      vector_put(&set->aliases, alias, sizeof(alias));
+    }
+  }
+
+  pointer_set_flatten(set, ctx, vector_begin(&trie), 0);
+
+  /* flattening stops short when out of memory */
+  i = vector_size(&trie, sizeof(PointerTrieNode));
+  vector_free(&trie);
+
+  return vector_size(&set->nodes, sizeof(PointerSetNode)) == i ? 0 : -1;
+}
+
+static int
+pointer_set_walk(PointerSet* set, JSContext* ctx, uint32_t index, JSValueConst obj, JSValue* out) {
+  PointerSetNode* nodes = vector_begin(&set->nodes);
+  uint32_t i, end = nodes[index].end;
+
+  for(i = index + 1; i < end; i = nodes[i].end) {
+    JSValue child;
+    int ret;
+
+    if((ret = js_get_property_hint(ctx, obj, nodes[i].atom, &nodes[i].slot, &child)) < 0)
+      return -1;
+
+    if(ret > 0) {
+      if(nodes[i].output != -1)
+        out[nodes[i].output] = JS_DupValue(ctx, child);
+
+      if(nodes[i].end > i + 1 && !JS_IsUndefined(child) && !JS_IsNull(child))
+        ret = pointer_set_walk(set, ctx, i, child, out);
+    }
+
+    JS_FreeValue(ctx, child);
+
+    if(ret < 0)
+      return -1;
+  }
+  return 0;
+}
+
+/* fills 'out' (noutputs values, initially undefined) with the values the pointers point to in 'obj'.
+ * values which do not exist stay undefined */
+int
+pointer_set_extract(PointerSet* set, JSContext* ctx, JSValueConst obj, JSValue* out) {
+  PointerSetNode* root = vector_begin(&set->nodes);
+  int32_t* aliases = vector_begin(&set->aliases);
+  size_t i, n = vector_size(&set->aliases, sizeof(int32_t) * 2);
+
+  if(root->output != -1)
+    out[root->output] = JS_DupValue(ctx, obj);
+
+  if(pointer_set_walk(set, ctx, 0, obj, out))
+    return -1;
+
+  for(i = 0; i < n; i++) out[aliases[i * 2 + 1]] = JS_DupValue(ctx, out[aliases[i * 2]]);
+
+  return 0;
+}
+
+void
+pointer_set_free(PointerSet* set, JSRuntime* rt) {
+  PointerSetNode* node;
+  uint32_t i;
+
+  vector_foreach_t(&set->nodes, node) if(node->atom != JS_ATOM_NULL) JS_FreeAtomRT(rt, node->atom);
+
+  if(set->names) {
+    for(i = 0; i < set->noutputs; i++) JS_FreeAtomRT(rt, set->names[i]);
+    js_free_rt(rt, set->names);
+  }
+
+  vector_free(&set->nodes);
+  vector_free(&set->aliases);
+}
@@ -3,15 +3,41 @@
 
 #include "quickjs.h"
 #include "cutils.h"
+#include "vector.h"
 #include <stdint.h>
 
+#define POINTER_INLINE_ATOMS 6
+#define POINTER_CACHE_SIZE 64
+
 typedef struct Pointer {
   size_t n;
   JSAtom* atoms;
+  size_t nslots;
+  uint32_t* slots; /* property slot hints for pointer_deref() */
+  size_t capacity;
+  JSAtom inline_atoms[POINTER_INLINE_ATOMS]; /* short paths are stored without allocation */
 } Pointer;
 
 typedef Pointer* DataFunc(JSContext*, JSValueConst);
 
+/* most recently used parse results of pointer_fromstring(), one per context */
+typedef struct PointerCache PointerCache;
+
+typedef struct PointerSetNode {
+  JSAtom atom;
+  uint32_t slot;  /* property slot hint */
+  uint32_t end;   /* index after the last node of the subtree */
+  int32_t output; /* index of the pointer ending here or -1 */
+} PointerSetNode;
+
+/* a trie of many pointers, nodes are stored in preorder */
+typedef struct PointerSet {
+  Vector nodes;
+  Vector aliases; /* pairs of output indices for duplicate pointers */
+  uint32_t noutputs;
+  JSAtom* names; /* the pointers as strings */
+} PointerSet;
+
 void pointer_copy(Pointer*, Pointer*, JSContext*);
 JSValue pointer_deref(Pointer*, JSContext*, JSValue);
 JSValue pointer_acquire(Pointer*, JSContext*, JSValue);
@@ -28,6 +54,14 @@ Pointer* pointer_slice(Pointer*, JSContext*, int64_t, int64_t);
 void pointer_tostring(Pointer*, JSContext*, DynBuf*);
 JSValue pointer_toarray(Pointer* ptr, JSContext* ctx);
 void pointer_truncate(Pointer*, JSContext*, size_t);
+int pointer_reserve(Pointer*, JSContext*, size_t);
+PointerCache* pointer_cache_new(JSContext*);
+void pointer_cache_free(PointerCache*, JSRuntime*);
+void pointer_cache_clear(PointerCache*, JSRuntime*);
+uint32_t pointer_cache_size(const PointerCache*);
+int pointer_set_compile(PointerSet*, JSContext*, Pointer* const*, size_t);
+int pointer_set_extract(PointerSet*, JSContext*, JSValue, JSValue* out);
+void pointer_set_free(PointerSet*, JSRuntime*);
 
 static inline Pointer*
 pointer_new(JSContext* ctx) {
@@ -49,9 +83,11 @@ pointer_dup(Pointer* other, JSContext* ctx) {
 }
 
 static inline void
-pointer_push(Pointer* ptr, JSAtom atom) {
-  ptr->atoms = realloc(ptr->atoms, (ptr->n + 1) * sizeof(JSAtom));
-  ptr->atoms[ptr->n++] = atom;
+pointer_push(Pointer* ptr, JSContext* ctx, JSAtom atom) {
+  if(ptr->n < ptr->capacity || !pointer_reserve(ptr, ctx, ptr->n + 1))
+    ptr->atoms[ptr->n++] = atom;
+  else
+    JS_FreeAtom(ctx, atom);
 }
 
 static inline JSAtom
@@ -6,6 +6,7 @@
 #include "libregexp.h"
 #include "quickjs-predicate.h"
 #include "cutils.h"
+#include <math.h>
 
 static size_t
 utf8_to_unicode(const char* str, size_t len, Vector* out) {
@@ -20,8 +21,212 @@ utf8_to_unicode(const char* str, size_t len, Vector* out) {
   return vector_size(out, sizeof(uint32_t));
 }
 
-int
-predicate_eval(Predicate* pr, JSContext* ctx, int argc, JSValueConst* argv) {
+/* the characters of a string or the bytes of an ArrayBuffer, read in place */
+typedef struct {
+  const uint8_t* data;
+  size_t len;
+  enum { TEXT_LATIN1 = 0, TEXT_UTF16, TEXT_UTF8 } encoding;
+} PredicateText;
+
+static PredicateText
+predicate_text(JSContext* ctx, JSValueConst value) {
+  PredicateText ret = {(const uint8_t*)"", 0, TEXT_LATIN1};
+
+  if(JS_IsString(value)) {
+    JSString* str = JS_VALUE_GET_PTR(value);
+
+    ret.data = str->u.str8;
+    ret.len = str->len;
+    ret.encoding = str->is_wide_char ? TEXT_UTF16 : TEXT_LATIN1;
+  } else if(js_value_isclass(ctx, value, JS_CLASS_ARRAY_BUFFER)) {
+    size_t size;
+    uint8_t* data;
+
+    if((data = JS_GetArrayBuffer(ctx, &size, value))) {
+      ret.data = data;
+      ret.len = size;
+      ret.encoding = TEXT_UTF8;
+    }
+  }
+  return ret;
+}
+
+/* returns the codepoint at 'pos' and advances it, -1 on invalid UTF-8 */
+static inline uint32_t
+predicate_text_getc(const PredicateText* text, size_t* pos) {
+  switch(text->encoding) {
+    case TEXT_LATIN1: return text->data[(*pos)++];
+
+    case TEXT_UTF16: {
+      const uint16_t* s = (const uint16_t*)text->data;
+      uint32_t c = s[(*pos)++];
+
+      if(c >= 0xd800 && c < 0xdc00 && *pos < text->len && s[*pos] >= 0xdc00 && s[*pos] < 0xe000)
+        c = 0x10000 + ((c - 0xd800) << 10) + (s[(*pos)++] - 0xdc00);
+
+      return c;
+    }
+
+    default: {
+      const uint8_t* next;
+      int c;
+
+      if(text->data[*pos] < 0x80)
+        return text->data[(*pos)++];
+
+      if((c = unicode_from_utf8(text->data + *pos, text->len - *pos, &next)) < 0) {
+        (*pos)++;
+        return (uint32_t)-1;
+      }
+
+      *pos = next - text->data;
+      return c;
+    }
+  }
+}
+
+static int
+predicate_compare_codepoints(const void* a, const void* b) {
+  uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+
+  return x < y ? -1 : x > y ? 1 : 0;
+}
+
+/* builds the bitmap and the range table from the set */
+static void
+predicate_charset_compile(CharsetPredicate* cs, JSContext* ctx) {
+  Vector wide = VECTOR(ctx);
+  uint32_t *p, *q, *end;
+
+  if(cs->chars.data == 0) {
+    vector_init(&cs->chars, ctx);
+    utf8_to_unicode(cs->set, cs->len, &cs->chars);
+  }
+
+  memset(cs->bitmap, 0, sizeof(cs->bitmap));
+  vector_free(&cs->ranges);
+  vector_init(&cs->ranges, ctx);
+
+  vector_foreach_t(&cs->chars, p) {
+    if(*p < 256)
+      cs->bitmap[*p >> 5] |= 1u << (*p & 31);
+    else
+      vector_push(&wide, *p);
+  }
+
+  qsort(vector_begin(&wide), vector_size(&wide, sizeof(uint32_t)), sizeof(uint32_t), &predicate_compare_codepoints);
+
+  /* merge runs of adjacent codepoints */
+  for(p = vector_begin(&wide), end = vector_end(&wide); p != end; p = q) {
+    uint32_t range[2] = {*p, *p};
+
+    for(q = p + 1; q != end && *q <= range[1] + 1; q++) range[1] = *q;
+
+    vector_put(&cs->ranges, range, sizeof(range));
+  }
+
+  vector_free(&wide);
+  cs->compiled = TRUE;
+}
+
+static BOOL
+predicate_charset_contains(const CharsetPredicate* cs, uint32_t codepoint) {
+  const uint32_t* ranges;
+  size_t lo, hi;
+
+  if(codepoint < 256)
+    return !!(cs->bitmap[codepoint >> 5] & (1u << (codepoint & 31)));
+
+  ranges = vector_begin(&cs->ranges);
+  lo = 0;
+  hi = vector_size(&cs->ranges, sizeof(uint32_t) * 2);
+
+  while(lo < hi) {
+    size_t mid = (lo + hi) >> 1;
+
+    if(codepoint < ranges[mid * 2])
+      hi = mid;
+    else if(codepoint > ranges[mid * 2 + 1])
+      lo = mid + 1;
+    else
+      return TRUE;
+  }
+  return FALSE;
+}
+
+static int
+predicate_property_has(PredicateCache* cache, JSContext* ctx, JSValueConst obj, JSAtom atom) {
+  JSShapeProperty* prs;
+  JSObject* holder;
+  int ret;
+
+  if((ret = js_shape_lookup(obj, atom, &cache->slot, &holder, &prs)) >= 0)
+    return ret;
+
+  return JS_HasProperty(ctx, obj, atom);
+}
+
+static JSValue
+predicate_property_get(PredicateCache* cache, JSContext* ctx, JSValueConst obj, JSAtom atom) {
+  JSValue value;
+
+  if(js_get_property_hint(ctx, obj, atom, &cache->slot, &value) < 0)
+    return JS_EXCEPTION;
+
+  return value;
+}
+
+/* OrdinaryHasInstance() for plain functions, -1 when JS_IsInstanceOf() is needed */
+static int
+predicate_has_instance(PredicateCache* cache, JSContext* ctx, JSValueConst obj, JSValueConst ctor) {
+  JSShapeProperty* prs;
+  JSObject *c, *p, *proto;
+  JSValue prototype;
+
+  if(!JS_IsObject(ctor))
+    return -1;
+
+  c = JS_VALUE_GET_OBJ(ctor);
+
+  /* Function.prototype[Symbol.hasInstance] is neither writable nor configurable */
+  if(c->is_exotic || c->class_id == JS_CLASS_BOUND_FUNCTION || c->shape->proto != JS_VALUE_GET_OBJ(ctx->function_proto) ||
+     !JS_IsFunction(ctx, ctor))
+    return -1;
+
+  if(!cache->prototype) {
+    cache->prototype = JS_NewAtom(ctx, "prototype");
+    cache->has_instance = js_symbol_atom(ctx, "hasInstance");
+  }
+
+  if(js_shape_find(c, cache->has_instance, 0))
+    return -1;
+
+  if(!(prs = js_shape_find(c, cache->prototype, &cache->slot)) || (prs->flags & JS_PROP_TMASK) != JS_PROP_NORMAL)
+    return -1;
+
+  prototype = c->prop[prs - c->shape->prop].u.value;
+
+  if(!JS_IsObject(prototype))
+    return -1;
+
+  if(!JS_IsObject(obj))
+    return 0;
+
+  proto = JS_VALUE_GET_OBJ(prototype);
+
+  for(p = JS_VALUE_GET_OBJ(obj); p->class_id != JS_CLASS_PROXY;) {
+    if(!(p = p->shape->proto))
+      return 0;
+
+    if(p == proto)
+      return 1;
+  }
+
+  return -1;
+}
+
+static int
+predicate_interpret(Predicate* pr, JSContext* ctx, int argc, JSValueConst* argv) {
   int ret = 0;
 
   switch(pr->id) {
@@ -32,30 +237,58 @@ predicate_eval(Predicate* pr, JSContext* ctx, int argc, JSValueConst* argv) {
     }
 
     case PREDICATE_CHARSET: {
-      InputBuffer input = js_input_buffer(ctx, argv[0]);
-      if(pr->charset.chars.size == 0 && pr->charset.chars.data == 0) {
-        vector_init(&pr->charset.chars, ctx);
-        utf8_to_unicode(pr->charset.set, pr->charset.len, &pr->charset.chars);
-      }
+      PredicateText text = predicate_text(ctx, argv[0]);
+      const uint32_t* bitmap = pr->charset.bitmap;
+      size_t pos = 0;
+
+      if(!pr->charset.compiled)
+        predicate_charset_compile(&pr->charset, ctx);
+
       ret = 1;
-      while(!input_buffer_eof(&input)) {
-        uint32_t codepoint = input_buffer_getc(&input);
-        ssize_t idx = vector_find(&pr->charset.chars, sizeof(uint32_t), &codepoint);
-        if(idx == -1) {
+
+      /* 8-bit strings are latin1, every char is in the bitmap range */
+      if(text.encoding == TEXT_LATIN1) {
+        for(; pos < text.len; pos++) {
+          uint8_t c = text.data[pos];
+
+          if(!(bitmap[c >> 5] & (1u << (c & 31)))) {
+            ret = 0;
+            break;
+          }
+        }
+        break;
+      }
+
+      while(pos < text.len) {
+        if(!predicate_charset_contains(&pr->charset, predicate_text_getc(&text, &pos))) {
           ret = 0;
           break;
         }
       }
-      input_buffer_free(&input, ctx);
       break;
     }
 
     case PREDICATE_STRING: {
-      InputBuffer input = js_input_buffer(ctx, argv[0]);
+      PredicateText text = predicate_text(ctx, argv[0]);
+      const uint8_t *p = (const uint8_t*)pr->string.str, *end = p + pr->string.len, *next;
+      size_t pos = 0;
+
+      if(text.encoding == TEXT_UTF8) {
+        ret = text.len >= pr->string.len && !memcmp(text.data, p, pr->string.len);
+        break;
+      }
+
+      ret = 1;
+      while(p < end) {
+        int c = *p < 0x80 ? *p++ : unicode_from_utf8(p, end - p, &next);
 
-      if(input.size >= pr->string.len) {
-        if(!memcmp(input.data, pr->string.str, pr->string.len))
-          ret = 1;
+        if(c >= 0x80)
+          p = next;
+
+        if(pos >= text.len || (uint32_t)c != predicate_text_getc(&text, &pos)) {
+          ret = 0;
+          break;
+        }
       }
       break;
     }
@@ -100,21 +333,24 @@ predicate_eval(Predicate* pr, JSContext* ctx, int argc, JSValueConst* argv) {
     }
 
     case PREDICATE_REGEXP: {
-      InputBuffer input = js_input_buffer(ctx, argv[0]);
+      PredicateText text = predicate_text(ctx, argv[0]);
+      int shift = text.encoding == TEXT_UTF16;
       uint8_t* capture[CAPTURE_COUNT_MAX * 2];
-      int capture_count = 0;
+      int capture_count;
 
       if(pr->regexp.bytecode == 0)
-        capture_count = predicate_regexp_compile(pr, ctx);
+        predicate_regexp_compile(pr, ctx);
+
+      capture_count = lre_get_capture_count(pr->regexp.bytecode);
 
-      ret = lre_exec(capture, pr->regexp.bytecode, (uint8_t*)input.data, 0, input.size, 0, ctx);
+      ret = lre_exec(capture, pr->regexp.bytecode, text.data, 0, text.len, shift, ctx);
 
-      if(ret && argc > 1) {
+      if(ret == 1 && argc > 1) {
 
         if(JS_IsFunction(ctx, argv[1])) {
-          JSValue args[] = {predicate_regexp_capture(capture, capture_count, input.data, ctx), argv[0]};
+          JSValue args[] = {predicate_regexp_capture(capture, capture_count, text.data, shift, ctx), argv[0]};
 
-          JS_Call(ctx, argv[1], JS_NULL, 2, args);
+          JS_FreeValue(ctx, JS_Call(ctx, argv[1], JS_NULL, 2, args));
 
           JS_FreeValue(ctx, args[0]);
 
@@ -126,8 +362,8 @@ predicate_eval(Predicate* pr, JSContext* ctx, int argc, JSValueConst* argv) {
 
             if(capture[i]) {
               a = JS_NewArray(ctx);
-              JS_SetPropertyUint32(ctx, a, 0, JS_NewUint32(ctx, capture[i] - input.data));
-              JS_SetPropertyUint32(ctx, a, 1, JS_NewUint32(ctx, capture[i + 1] - input.data));
+              JS_SetPropertyUint32(ctx, a, 0, JS_NewUint32(ctx, (capture[i] - text.data) >> shift));
+              JS_SetPropertyUint32(ctx, a, 1, JS_NewUint32(ctx, (capture[i + 1] - text.data) >> shift));
             }
 
             JS_SetPropertyUint32(ctx, argv[1], i >> 1, a);
@@ -139,14 +375,20 @@ predicate_eval(Predicate* pr, JSContext* ctx, int argc, JSValueConst* argv) {
     }
 
     case PREDICATE_INSTANCEOF: {
-      ret = JS_IsInstanceOf(ctx, argv[0], pr->unary.predicate);
+      if((ret = predicate_has_instance(&pr->cache, ctx, argv[0], pr->unary.predicate)) < 0)
+        ret = JS_IsInstanceOf(ctx, argv[0], pr->unary.predicate);
       break;
     }
 
     case PREDICATE_PROTOTYPEIS: {
-      JSValue proto = JS_GetPrototype(ctx, argv[0]);
+      JSObject* proto;
 
-      ret = JS_VALUE_GET_OBJ(proto) == JS_VALUE_GET_OBJ(pr->unary.predicate);
+      if(JS_IsObject(argv[0]) && JS_VALUE_GET_OBJ(argv[0])->class_id != JS_CLASS_PROXY)
+        proto = JS_VALUE_GET_OBJ(argv[0])->shape->proto;
+      else
+        proto = JS_VALUE_GET_OBJ(JS_GetPrototype(ctx, argv[0]));
+
+      ret = proto == JS_VALUE_GET_OBJ(pr->unary.predicate);
       break;
     }
 
@@ -157,11 +399,15 @@ predicate_eval(Predicate* pr, JSContext* ctx, int argc, JSValueConst* argv) {
 
     case PREDICATE_PROPERTY: {
       if(JS_IsUndefined(pr->property.predicate)) {
-        ret = JS_HasProperty(ctx, argv[0], pr->property.atom);
+        ret = predicate_property_has(&pr->cache, ctx, argv[0], pr->property.atom);
       } else {
-        JSValueConst args[] = {JS_GetProperty(ctx, argv[0], pr->property.atom)};
+        JSValue args[] = {predicate_property_get(&pr->cache, ctx, argv[0], pr->property.atom)};
+
+        if(JS_IsException(args[0]))
+          return -1;
 
         ret = predicate_call(ctx, pr->property.predicate, 1, args);
+        JS_FreeValue(ctx, args[0]);
       }
       break;
     }
@@ -170,6 +416,14 @@ predicate_eval(Predicate* pr, JSContext* ctx, int argc, JSValueConst* argv) {
   return ret;
 }
 
+int
+predicate_eval(Predicate* pr, JSContext* ctx, int argc, JSValueConst* argv) {
+  if(pr->program)
+    return predicate_program_run(pr->program, ctx, argc, argv);
+
+  return predicate_interpret(pr, ctx, argc, argv);
+}
+
 int
 predicate_call(JSContext* ctx, JSValueConst value, int argc, JSValueConst* argv) {
   Predicate* pred;
@@ -333,15 +587,15 @@ predicate_tostring(const Predicate* pr, JSContext* ctx, DynBuf* dbuf) {
 }
 
 JSValue
-predicate_regexp_capture(uint8_t** capture, int capture_count, uint8_t* input, JSContext* ctx) {
+predicate_regexp_capture(uint8_t** capture, int capture_count, const uint8_t* input, int shift, JSContext* ctx) {
   int i;
   uint32_t buf[capture_count * 2];
   memset(buf, 0, sizeof(buf));
 
   for(i = 0; i < 2 * capture_count; i += 2) {
     if(capture[i]) {
-      buf[i] = capture[i] - input;
-      buf[i + 1] = capture[i + 1] - input;
+      buf[i] = (capture[i] - input) >> shift;
+      buf[i + 1] = (capture[i + 1] - input) >> shift;
     }
   }
 
@@ -358,6 +612,7 @@ predicate_free_rt(Predicate* pred, JSRuntime* rt) {
     case PREDICATE_CHARSET: {
       js_free_rt(rt, pred->charset.set);
       vector_free(&pred->charset.chars);
+      vector_free(&pred->charset.ranges);
       break;
     }
 
@@ -394,6 +649,14 @@ predicate_free_rt(Predicate* pred, JSRuntime* rt) {
       break;
     }
   }
+  if(pred->program)
+    predicate_program_free(pred->program, rt);
+  if(pred->batch)
+    predicate_program_free(pred->batch, rt);
+  if(pred->cache.prototype)
+    JS_FreeAtomRT(rt, pred->cache.prototype);
+  if(pred->cache.has_instance)
+    JS_FreeAtomRT(rt, pred->cache.has_instance);
   memset(pred, 0, sizeof(Predicate));
 }
 
@@ -448,6 +711,9 @@ predicate_dup(const Predicate* pred, JSContext* ctx) {
       ret->charset.len = pred->charset.len;
       ret->charset.set = js_strndup(ctx, pred->charset.set, pred->charset.len);
       vector_copy(&ret->charset.chars, &pred->charset.chars);
+      vector_copy(&ret->charset.ranges, &pred->charset.ranges);
+      memcpy(ret->charset.bitmap, pred->charset.bitmap, sizeof(ret->charset.bitmap));
+      ret->charset.compiled = pred->charset.compiled;
       break;
     }
 
@@ -501,3 +767,656 @@ predicate_regexp_compile(Predicate* pred, JSContext* ctx) {
 
   return 0;
 }
+
+typedef struct {
+  PredicateProgram* prog;
+  Vector labels;
+} PredicateCompiler;
+
+enum { LABEL_ACCEPT = 0, LABEL_REJECT };
+
+static int32_t
+predicate_compiler_label(PredicateCompiler* pc) {
+  int32_t addr = -1;
+  vector_push(&pc->labels, addr);
+  return vector_size(&pc->labels, sizeof(int32_t)) - 1;
+}
+
+static void
+predicate_compiler_define(PredicateCompiler* pc, int32_t label) {
+  *(int32_t*)vector_at(&pc->labels, sizeof(int32_t), label) = vector_size(&pc->prog->instrs, sizeof(PredicateInstr));
+}
+
+static PredicateInstr*
+predicate_compiler_emit(PredicateCompiler* pc, JSContext* ctx, int32_t op, JSValueConst value, int32_t t, int32_t f) {
+  PredicateInstr* instr;
+
+  if((instr = vector_emplace(&pc->prog->instrs, sizeof(PredicateInstr)))) {
+    memset(instr, 0, sizeof(PredicateInstr));
+    instr->op = op;
+    instr->jump[0] = f;
+    instr->jump[1] = t;
+    instr->value = value;
+  }
+  return instr;
+}
+
+static int predicate_compiler_node(PredicateCompiler*, JSContext*, JSValueConst, int32_t t, int32_t f);
+
+/* an operand of a flattened AND/OR */
+typedef struct {
+  JSValueConst value; /* JS_UNDEFINED for a (merged) type test */
+  BOOL negate;
+  int type, cost;
+} PredicateOperand;
+
+#define PREDICATE_COST_CALL 100
+
+static int
+predicate_compiler_type(PredicateCompiler* pc, JSContext* ctx, int type, int32_t t, int32_t f) {
+  PredicateInstr* instr;
+
+  if(!(instr = predicate_compiler_emit(pc, ctx, PREDICATE_TYPE, JS_UNDEFINED, t, f)))
+    return -1;
+
+  instr->type = type;
+  return 0;
+}
+
+static int
+predicate_compiler_cost(Predicate* pr) {
+  switch(pr->id) {
+    case PREDICATE_TYPE: return 0;
+    case PREDICATE_EQUAL:
+    case PREDICATE_INSTANCEOF:
+    case PREDICATE_PROTOTYPEIS: return 1;
+    case PREDICATE_STRING:
+    case PREDICATE_CHARSET: return 2;
+    case PREDICATE_PROPERTY: return JS_IsUndefined(pr->property.predicate) ? 1 : 3;
+    case PREDICATE_REGEXP: return 4;
+    default: return 3;
+  }
+}
+
+/* whether evaluating 'value' may call a JS function, these operands are barriers which aren't reordered:
+ * PROPERTY can hit getters and Proxy traps, INSTANCEOF a user Symbol.hasInstance or getPrototypeOf trap,
+ * PROTOTYPEIS the latter, REGEXP calls the capture callback passed to a compiled program */
+static BOOL
+predicate_compiler_calls(JSValueConst value) {
+  Predicate* pr;
+  size_t i;
+
+  if(!(pr = JS_GetOpaque(value, js_predicate_class_id)))
+    return TRUE;
+
+  switch(pr->id) {
+    case PREDICATE_NOTNOT:
+    case PREDICATE_NOT: return predicate_compiler_calls(pr->unary.predicate);
+    case PREDICATE_OR:
+    case PREDICATE_AND:
+    case PREDICATE_XOR: {
+      for(i = 0; i < pr->boolean.npredicates; i++)
+        if(predicate_compiler_calls(pr->boolean.predicates[i]))
+          return TRUE;
+      return FALSE;
+    }
+    case PREDICATE_PROPERTY:
+    case PREDICATE_INSTANCEOF:
+    case PREDICATE_PROTOTYPEIS:
+    case PREDICATE_REGEXP: return TRUE;
+    default: return FALSE;
+  }
+}
+
+/* collects the operands of nested AND/OR nodes of the same kind, NOT and NOTNOT are folded into the operands */
+static int
+predicate_compiler_operands(PredicateCompiler* pc, JSContext* ctx, JSValueConst value, BOOL negate, int id, Vector* out) {
+  PredicateOperand op = {value, negate, 0, PREDICATE_COST_CALL};
+  Predicate* pr;
+  size_t i;
+
+  while((pr = JS_GetOpaque(value, js_predicate_class_id)) && (pr->id == PREDICATE_NOT || pr->id == PREDICATE_NOTNOT)) {
+    negate ^= pr->id == PREDICATE_NOT;
+    value = pr->unary.predicate;
+  }
+
+  op.value = value;
+  op.negate = negate;
+
+  if(pr) {
+    /* De Morgan: a negated AND is an OR of negated operands and vice versa */
+    int kind = pr->id == PREDICATE_AND ? (negate ? PREDICATE_OR : PREDICATE_AND)
+               : pr->id == PREDICATE_OR ? (negate ? PREDICATE_AND : PREDICATE_OR)
+                                        : -1;
+
+    if(kind == id) {
+      if(pr->boolean.npredicates == 0) {
+        op.value = JS_UNDEFINED;
+        op.cost = 0;
+        vector_push(out, op);
+        return 0;
+      }
+
+      for(i = 0; i < pr->boolean.npredicates; i++)
+        if(predicate_compiler_operands(pc, ctx, pr->boolean.predicates[i], negate, id, out))
+          return -1;
+
+      return 0;
+    }
+
+    if(pr->id == PREDICATE_TYPE) {
+      op.value = JS_UNDEFINED;
+      op.type = pr->type.flags;
+    }
+
+    op.cost = predicate_compiler_calls(value) ? PREDICATE_COST_CALL : predicate_compiler_cost(pr);
+  }
+
+  vector_push(out, op);
+  return 0;
+}
+
+/* stable sort by cost, the cheap tests first */
+static void
+predicate_compiler_sort(PredicateOperand* ops, size_t n) {
+  size_t i, j;
+
+  for(i = 1; i < n; i++) {
+    PredicateOperand op = ops[i];
+
+    for(j = i; j > 0 && ops[j - 1].cost > op.cost; j--) ops[j] = ops[j - 1];
+
+    ops[j] = op;
+  }
+}
+
+/* emits a flattened AND/OR, after merging type tests, removing duplicate operands and moving cheap tests first.
+ * operands which may call JS functions split the list into runs, nothing is merged, dropped or moved across them,
+ * so the functions are called in the same order and under the same conditions as by the interpreter. */
+static int
+predicate_compiler_boolean(PredicateCompiler* pc, JSContext* ctx, int id, Vector* operands, int32_t t, int32_t f) {
+  PredicateOperand *ops = vector_begin(operands), *merged = 0;
+  size_t i, j, k, start = 0, n = vector_size(operands, sizeof(PredicateOperand));
+  BOOL is_and = id == PREDICATE_AND, decided = FALSE;
+
+  for(i = 0, j = 0; i < n && !decided; i++) {
+    PredicateOperand op = ops[i];
+
+    if(op.cost == PREDICATE_COST_CALL) {
+      predicate_compiler_sort(&ops[start], j - start);
+      ops[j++] = op;
+      start = j;
+      merged = 0;
+      continue;
+    }
+
+    /* a type test is constant when its mask is empty, the remaining operands are never reached */
+    if(JS_IsUndefined(op.value) && op.type == 0) {
+      if(op.negate != is_and)
+        decided = TRUE;
+      continue;
+    }
+
+    /* type tests can be merged as long as they are ORed, e.g. NOT(a) AND NOT(b) == NOT(a | b) */
+    if(JS_IsUndefined(op.value) && op.negate == is_and) {
+      if(merged) {
+        merged->type |= op.type;
+        continue;
+      }
+      ops[j] = op;
+      merged = &ops[j++];
+      continue;
+    }
+
+    for(k = start; k < j; k++) {
+      if(JS_IsUndefined(ops[k].value) || JS_VALUE_GET_PTR(ops[k].value) != JS_VALUE_GET_PTR(op.value))
+        continue;
+
+      /* (a AND NOT a) and (a OR NOT a) are constant */
+      if(ops[k].negate != op.negate)
+        decided = TRUE;
+
+      break;
+    }
+
+    if(k == j)
+      ops[j++] = op;
+  }
+
+  predicate_compiler_sort(&ops[start], j - start);
+
+  for(i = 0, n = j; i < n; i++) {
+    int32_t next = i + 1 < n || decided ? predicate_compiler_label(pc) : -1;
+    int32_t ok = next == -1 ? t : is_and ? next : t;
+    int32_t fail = next == -1 ? f : is_and ? f : next;
+    int32_t tt = ops[i].negate ? fail : ok, ff = ops[i].negate ? ok : fail;
+
+    if(JS_IsUndefined(ops[i].value) ? predicate_compiler_type(pc, ctx, ops[i].type, tt, ff)
+                                    : predicate_compiler_node(pc, ctx, ops[i].value, tt, ff))
+      return -1;
+
+    if(next != -1)
+      predicate_compiler_define(pc, next);
+  }
+
+  /* a decided AND fails and a decided OR matches, with no operands left an AND matches and an OR fails */
+  if(decided || n == 0) {
+    int32_t dest = decided == is_and ? f : t;
+    return predicate_compiler_type(pc, ctx, 0, dest, dest);
+  }
+
+  return 0;
+}
+
+/* emits code which jumps to label 't' when 'value' matches and to label 'f' otherwise */
+static int
+predicate_compiler_node(PredicateCompiler* pc, JSContext* ctx, JSValueConst value, int32_t t, int32_t f) {
+  PredicateInstr* instr;
+  Predicate* pr;
+  size_t i;
+
+  if(!(pr = JS_GetOpaque(value, js_predicate_class_id))) {
+    if(!JS_IsFunction(ctx, value)) {
+      JS_ThrowTypeError(ctx, "predicate is neither a Predicate nor a function");
+      return -1;
+    }
+    return predicate_compiler_emit(pc, ctx, PREDICATE_OP_CALL, value, t, f) ? 0 : -1;
+  }
+
+  switch(pr->id) {
+    case PREDICATE_NOTNOT: return predicate_compiler_node(pc, ctx, pr->unary.predicate, t, f);
+    case PREDICATE_NOT: return predicate_compiler_node(pc, ctx, pr->unary.predicate, f, t);
+
+    case PREDICATE_AND:
+    case PREDICATE_OR: {
+      Vector operands = VECTOR(ctx);
+      int ret;
+
+      /* empty AND/OR never match, like the interpreter */
+      if(pr->boolean.npredicates == 0)
+        return predicate_compiler_type(pc, ctx, 0, t, f);
+
+      if(!(ret = predicate_compiler_operands(pc, ctx, value, FALSE, pr->id, &operands)))
+        ret = predicate_compiler_boolean(pc, ctx, pr->id, &operands, t, f);
+
+      vector_free(&operands);
+      return ret;
+    }
+
+    case PREDICATE_XOR: {
+      if(!(instr = predicate_compiler_emit(pc, ctx, PREDICATE_XOR, value, t, f)))
+        return -1;
+
+      if(!(instr->xor.subs = js_mallocz(ctx, sizeof(PredicateProgram*) * pr->boolean.npredicates)))
+        return -1;
+
+      for(i = 0; i < pr->boolean.npredicates; i++) {
+        PredicateProgram* sub;
+
+        if(!(sub = predicate_compile(pr->boolean.predicates[i], ctx)))
+          return -1;
+
+        /* the instruction may have moved while compiling */
+        instr = vector_back(&pc->prog->instrs, sizeof(PredicateInstr));
+        instr->xor.subs[instr->xor.nsubs++] = sub;
+      }
+      return 0;
+    }
+
+    case PREDICATE_PROPERTY: {
+      if(!(instr = predicate_compiler_emit(pc, ctx, PREDICATE_PROPERTY, value, t, f)))
+        return -1;
+
+      instr->property.atom = JS_DupAtom(ctx, pr->property.atom);
+      instr->property.cache = &pr->cache;
+
+      if(!JS_IsUndefined(pr->property.predicate)) {
+        PredicateProgram* sub;
+
+        if(!(sub = predicate_compile(pr->property.predicate, ctx)))
+          return -1;
+
+        instr = vector_back(&pc->prog->instrs, sizeof(PredicateInstr));
+        instr->property.sub = sub;
+      }
+      return 0;
+    }
+
+    case PREDICATE_TYPE: return predicate_compiler_type(pc, ctx, pr->type.flags, t, f);
+
+    default: {
+      if(!(instr = predicate_compiler_emit(pc, ctx, pr->id, value, t, f)))
+        return -1;
+
+      instr->leaf = pr;
+      return 0;
+    }
+  }
+}
+
+PredicateProgram*
+predicate_compile(JSValueConst value, JSContext* ctx) {
+  PredicateCompiler pc;
+  PredicateInstr* instr;
+  int32_t *labels, n;
+
+  if(!(pc.prog = js_mallocz(ctx, sizeof(PredicateProgram))))
+    return 0;
+
+  vector_init_rt(&pc.prog->instrs, JS_GetRuntime(ctx));
+  vector_init(&pc.labels, ctx);
+
+  predicate_compiler_label(&pc);
+  predicate_compiler_label(&pc);
+
+  if(predicate_compiler_node(&pc, ctx, value, LABEL_ACCEPT, LABEL_REJECT)) {
+    vector_free(&pc.labels);
+    predicate_program_free(pc.prog, JS_GetRuntime(ctx));
+    return 0;
+  }
+
+  n = vector_size(&pc.prog->instrs, sizeof(PredicateInstr));
+  labels = vector_begin(&pc.labels);
+  labels[LABEL_ACCEPT] = n;
+  labels[LABEL_REJECT] = n + 1;
+
+  /* resolve labels to instruction indices */
+  vector_foreach_t(&pc.prog->instrs, instr) {
+    instr->jump[0] = labels[instr->jump[0]];
+    instr->jump[1] = labels[instr->jump[1]];
+  }
+
+  vector_free(&pc.labels);
+  return pc.prog;
+}
+
+int
+predicate_program_run(const PredicateProgram* prog, JSContext* ctx, int argc, JSValueConst* argv) {
+  const PredicateInstr* instrs = vector_begin(&prog->instrs);
+  int32_t pc = 0, n = vector_size(&prog->instrs, sizeof(PredicateInstr));
+
+  while(pc < n) {
+    const PredicateInstr* instr = &instrs[pc];
+    int ret;
+
+    switch(instr->op) {
+      case PREDICATE_TYPE: {
+        ret = !!(js_value_type(ctx, argv[0]) & instr->type);
+        break;
+      }
+
+      case PREDICATE_PROPERTY: {
+        if(!instr->property.sub) {
+          ret = predicate_property_has(instr->property.cache, ctx, argv[0], instr->property.atom);
+        } else {
+          JSValue prop = predicate_property_get(instr->property.cache, ctx, argv[0], instr->property.atom);
+
+          if(JS_IsException(prop))
+            return -1;
+
+          ret = predicate_program_run(instr->property.sub, ctx, 1, &prop);
+          JS_FreeValue(ctx, prop);
+        }
+        break;
+      }
+
+      case PREDICATE_XOR: {
+        size_t i;
+        int r;
+
+        for(ret = 0, i = 0; i < instr->xor.nsubs; i++) {
+          if((r = predicate_program_run(instr->xor.subs[i], ctx, argc, argv)) < 0)
+            return r;
+          ret ^= r;
+        }
+        break;
+      }
+
+      case PREDICATE_OP_CALL: {
+        ret = predicate_call(ctx, instr->value, argc, argv);
+        break;
+      }
+
+      default: {
+        ret = predicate_interpret(instr->leaf, ctx, argc, argv);
+        break;
+      }
+    }
+
+    if(ret < 0)
+      return ret;
+
+    pc = instr->jump[ret == 1];
+  }
+
+  return pc == n;
+}
+
+void
+predicate_program_free(PredicateProgram* prog, JSRuntime* rt) {
+  PredicateInstr* instr;
+
+  vector_foreach_t(&prog->instrs, instr) {
+    if(instr->op == PREDICATE_PROPERTY) {
+      JS_FreeAtomRT(rt, instr->property.atom);
+      if(instr->property.sub)
+        predicate_program_free(instr->property.sub, rt);
+    } else if(instr->op == PREDICATE_XOR && instr->xor.subs) {
+      size_t i;
+      for(i = 0; i < instr->xor.nsubs; i++) predicate_program_free(instr->xor.subs[i], rt);
+      js_free_rt(rt, instr->xor.subs);
+    }
+  }
+
+  vector_free(&prog->instrs);
+  js_free_rt(rt, prog);
+}
+
+void
+predicate_program_dump(const PredicateProgram* prog, JSContext* ctx, DynBuf* dbuf) {
+  const PredicateInstr* instr;
+  int32_t i = 0, n = vector_size(&prog->instrs, sizeof(PredicateInstr));
+
+  vector_foreach_t(&prog->instrs, instr) {
+    int j;
+
+    dbuf_printf(dbuf, "%3d  %-11s", i++, instr->op == PREDICATE_OP_CALL ? "CALL" : predicate_typename(&(Predicate){instr->op}));
+
+    for(j = 1; j >= 0; j--) {
+      dbuf_putstr(dbuf, j ? "  true -> " : "  false -> ");
+
+      if(instr->jump[j] >= n)
+        dbuf_putstr(dbuf, instr->jump[j] == n ? "ACCEPT" : "REJECT");
+      else
+        dbuf_printf(dbuf, "%d", instr->jump[j]);
+    }
+    dbuf_putc(dbuf, '\n');
+  }
+}
+
+#define PREDICATE_BATCH_LOOP(expr) \
+  for(i = 0; i < n; i++) count += (mask[i] = !!(expr))
+
+/* equality and type tests over typed arrays, without boxing the elements.
+ * returns -1 when there is no fast path for the predicate. */
+static int64_t
+predicate_batch_typedarray(Predicate* pr, JSObject* p, uint8_t* mask) {
+  uint32_t i, n = p->u.array.count;
+  int64_t count = 0;
+
+  if(pr->id == PREDICATE_TYPE) {
+    int flags = pr->type.flags;
+
+    switch(p->class_id) {
+      case JS_CLASS_UINT32_ARRAY:
+        PREDICATE_BATCH_LOOP(flags & (p->u.array.u.uint32_ptr[i] <= INT32_MAX ? TYPE_INT : TYPE_FLOAT64));
+        return count;
+      case JS_CLASS_FLOAT32_ARRAY:
+        PREDICATE_BATCH_LOOP(flags & (isnan(p->u.array.u.float_ptr[i]) ? TYPE_NAN : TYPE_FLOAT64));
+        return count;
+      case JS_CLASS_FLOAT64_ARRAY:
+        PREDICATE_BATCH_LOOP(flags & (isnan(p->u.array.u.double_ptr[i]) ? TYPE_NAN : TYPE_FLOAT64));
+        return count;
+#ifdef CONFIG_BIGNUM
+      case JS_CLASS_BIG_INT64_ARRAY:
+      case JS_CLASS_BIG_UINT64_ARRAY: flags &= TYPE_BIG_INT; break;
+#endif
+      default: flags &= TYPE_INT; break;
+    }
+
+    memset(mask, !!flags, n);
+    return flags ? n : 0;
+  }
+
+  if(pr->id == PREDICATE_EQUAL) {
+    JSValueConst value = pr->unary.predicate;
+
+    /* elements of integer arrays are boxed as ints, float elements as doubles */
+    if(JS_VALUE_GET_TAG(value) == JS_TAG_INT) {
+      int32_t v = JS_VALUE_GET_INT(value);
+
+      switch(p->class_id) {
+        case JS_CLASS_INT8_ARRAY: PREDICATE_BATCH_LOOP(p->u.array.u.int8_ptr[i] == v); return count;
+        case JS_CLASS_UINT8C_ARRAY:
+        case JS_CLASS_UINT8_ARRAY: PREDICATE_BATCH_LOOP(p->u.array.u.uint8_ptr[i] == v); return count;
+        case JS_CLASS_INT16_ARRAY: PREDICATE_BATCH_LOOP(p->u.array.u.int16_ptr[i] == v); return count;
+        case JS_CLASS_UINT16_ARRAY: PREDICATE_BATCH_LOOP(p->u.array.u.uint16_ptr[i] == v); return count;
+        case JS_CLASS_INT32_ARRAY: PREDICATE_BATCH_LOOP(p->u.array.u.int32_ptr[i] == v); return count;
+        case JS_CLASS_UINT32_ARRAY: PREDICATE_BATCH_LOOP(v >= 0 && p->u.array.u.uint32_ptr[i] == (uint32_t)v); return count;
+        case JS_CLASS_FLOAT32_ARRAY:
+        case JS_CLASS_FLOAT64_ARRAY: memset(mask, 0, n); return 0;
+      }
+    } else if(JS_VALUE_GET_TAG(value) == JS_TAG_FLOAT64) {
+      double v = JS_VALUE_GET_FLOAT64(value);
+
+      switch(p->class_id) {
+        case JS_CLASS_FLOAT32_ARRAY:
+          if(isnan(v))
+            PREDICATE_BATCH_LOOP(isnan(p->u.array.u.float_ptr[i]));
+          else
+            PREDICATE_BATCH_LOOP(p->u.array.u.float_ptr[i] == v);
+          return count;
+        case JS_CLASS_FLOAT64_ARRAY:
+          if(isnan(v))
+            PREDICATE_BATCH_LOOP(isnan(p->u.array.u.double_ptr[i]));
+          else
+            PREDICATE_BATCH_LOOP(p->u.array.u.double_ptr[i] == v);
+          return count;
+        case JS_CLASS_UINT32_ARRAY:
+          PREDICATE_BATCH_LOOP(p->u.array.u.uint32_ptr[i] > INT32_MAX && p->u.array.u.uint32_ptr[i] == v);
+          return count;
+        case JS_CLASS_INT8_ARRAY:
+        case JS_CLASS_UINT8C_ARRAY:
+        case JS_CLASS_UINT8_ARRAY:
+        case JS_CLASS_INT16_ARRAY:
+        case JS_CLASS_UINT16_ARRAY:
+        case JS_CLASS_INT32_ARRAY: memset(mask, 0, n); return 0;
+      }
+    }
+  }
+
+  return -1;
+}
+
+#undef PREDICATE_BATCH_LOOP
+
+/* runs the program cached by filter(), test() and count(), unless compile() installed one */
+static inline int
+predicate_batch_eval(Predicate* pr, JSContext* ctx, JSValueConst* value) {
+  if(!pr->program && pr->batch)
+    return predicate_program_run(pr->batch, ctx, 1, value);
+
+  return predicate_eval(pr, ctx, 1, value);
+}
+
+/* evaluates the predicate for each element into a mask, the matching elements of arrays are appended to 'matches' if
+ * it is an array */
+int64_t
+predicate_batch(Predicate* pr, JSContext* ctx, JSValueConst array, uint8_t** maskp, uint32_t* lenp, JSValueConst matches) {
+  JSObject* p;
+  uint8_t* mask;
+  uint32_t i, n;
+  int64_t len, count = 0;
+  BOOL is_typedarray;
+  int r;
+
+  if(!JS_IsObject(array)) {
+    JS_ThrowTypeError(ctx, "argument must be an array or a typed array");
+    return -1;
+  }
+
+  p = JS_VALUE_GET_OBJ(array);
+  is_typedarray = p->class_id >= JS_CLASS_UINT8C_ARRAY && p->class_id <= JS_CLASS_FLOAT64_ARRAY;
+
+  /* the 'length' property of a typed array can be shadowed, the mask is sized by the element count */
+  if(is_typedarray) {
+    n = p->u.array.count;
+  } else {
+    if((len = js_array_length(ctx, array)) < 0) {
+      JS_ThrowTypeError(ctx, "argument must be an array or a typed array");
+      return -1;
+    }
+
+    if(len > UINT32_MAX) {
+      JS_ThrowRangeError(ctx, "array too long");
+      return -1;
+    }
+
+    n = len;
+  }
+
+  if(!(mask = js_malloc(ctx, n ? n : 1)))
+    return -1;
+
+  if(is_typedarray) {
+    if((count = predicate_batch_typedarray(pr, p, mask)) < 0) {
+      for(count = 0, i = 0; i < n; i++) {
+        JSValue value;
+
+        /* the predicate may have detached or shrunk the buffer */
+        if(i >= p->u.array.count) {
+          mask[i] = 0;
+          continue;
+        }
+
+        value = js_typedarray_get(ctx, p, i);
+        r = predicate_batch_eval(pr, ctx, &value);
+        JS_FreeValue(ctx, value);
+
+        if(r < 0)
+          goto fail;
+
+        count += (mask[i] = r == 1);
+      }
+    }
+  } else {
+    for(i = 0; i < n; i++) {
+      JSValue value;
+
+      if(p->class_id == JS_CLASS_ARRAY && p->fast_array)
+        value = i < p->u.array.count ? JS_DupValue(ctx, p->u.array.u.values[i]) : JS_UNDEFINED;
+      else if(JS_IsException((value = JS_GetPropertyUint32(ctx, array, i))))
+        goto fail;
+
+      r = predicate_batch_eval(pr, ctx, &value);
+
+      if(r == 1 && JS_IsObject(matches) && JS_SetPropertyUint32(ctx, matches, count, JS_DupValue(ctx, value)) < 0)
+        r = -1;
+
+      JS_FreeValue(ctx, value);
+
+      if(r < 0)
+        goto fail;
+
+      count += (mask[i] = r == 1);
+    }
+  }
+
+  *maskp = mask;
+  *lenp = n;
+  return count;
+
+fail:
+  js_free(ctx, mask);
+  return -1;
+}
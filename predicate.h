@@ -29,6 +29,9 @@ typedef struct {
   char* set;
   size_t len;
   Vector chars;
+  BOOL compiled;
+  uint32_t bitmap[8]; /* codepoints 0-255 */
+  Vector ranges;      /* sorted [first, last] pairs of codepoints >= 256 */
 } CharsetPredicate;
 
 typedef struct {
@@ -59,6 +62,14 @@ typedef struct {
   JSValue predicate;
 } PropertyPredicate;
 
+struct PredicateProgram;
+
+/* slot hint and atoms for the native lookups of PROPERTY and INSTANCEOF */
+typedef struct {
+  uint32_t slot;
+  JSAtom prototype, has_instance;
+} PredicateCache;
+
 typedef struct Predicate {
   enum predicate_id id;
   union {
@@ -71,8 +82,38 @@ typedef struct Predicate {
     RegExpPredicate regexp;
     PropertyPredicate property;
   };
+  struct PredicateProgram* program;
+  struct PredicateProgram* batch; /* compiled by filter(), test() and count(), eval() doesn't use it */
+  PredicateCache cache;
 } Predicate;
 
+/* an instruction of a compiled predicate: a single test followed by a jump */
+#define PREDICATE_OP_CALL -1
+
+typedef struct PredicateInstr {
+  int32_t op;      /* predicate_id of the test or PREDICATE_OP_CALL */
+  int32_t jump[2]; /* next instruction when the test failed / succeeded */
+  JSValue value;   /* the Predicate object or function, owned by the tree */
+  union {
+    int type;
+    Predicate* leaf;
+    struct {
+      JSAtom atom;
+      struct PredicateProgram* sub;
+      PredicateCache* cache;
+    } property;
+    struct {
+      size_t nsubs;
+      struct PredicateProgram** subs;
+    } xor;
+  };
+} PredicateInstr;
+
+/* instructions, jumps to ninstrs accept and to ninstrs + 1 reject */
+typedef struct PredicateProgram {
+  Vector instrs;
+} PredicateProgram;
+
 #define PREDICATE_INIT(id)                                                                                             \
   {                                                                                                                    \
     id, {                                                                                                              \
@@ -84,12 +125,17 @@ static const size_t CAPTURE_COUNT_MAX = 255;
 int predicate_call(JSContext*, JSValue, int argc, JSValue* argv);
 VISIBLE int predicate_eval(Predicate*, JSContext*, int argc, JSValue* argv);
 void predicate_free_rt(Predicate*, JSRuntime*);
-JSValue predicate_regexp_capture(uint8_t**, int, uint8_t* input, JSContext* ctx);
+JSValue predicate_regexp_capture(uint8_t**, int, const uint8_t* input, int shift, JSContext* ctx);
 
 int predicate_regexp_compile(Predicate* pred, JSContext* ctx);
 void predicate_tostring(const Predicate*, JSContext*, DynBuf* dbuf);
 JSValue predicate_values(const Predicate*, JSContext*);
 Predicate* predicate_dup(const Predicate* pred, JSContext* ctx);
+PredicateProgram* predicate_compile(JSValueConst, JSContext*);
+int predicate_program_run(const PredicateProgram*, JSContext*, int argc, JSValueConst* argv);
+void predicate_program_free(PredicateProgram*, JSRuntime*);
+void predicate_program_dump(const PredicateProgram*, JSContext*, DynBuf* dbuf);
+int64_t predicate_batch(Predicate*, JSContext*, JSValueConst array, uint8_t** maskp, uint32_t* lenp, JSValueConst matches);
 
 static inline void
 predicate_free(Predicate* pred, JSContext* ctx) {
@@ -187,7 +187,7 @@ property_enumeration_free(Vector* vec, JSRuntime* rt) {
   PropertyEnumeration *it, *end;
   it = vector_begin(vec);
   end = vector_end(vec);
-  while(it++ != end) property_enumeration_reset(it, rt);
+  for(; it != end; it++) property_enumeration_reset(it, rt);
   // vector_free(vec);
 }
 
@@ -176,6 +176,39 @@ jsm_module_list(JSContext* ctx, JSValueConst this_val) {
   return ret;
 }
 
+/* opaque of the trace malloc functions, used with --trace or --count-allocs */
+struct trace_malloc_data {
+  uint8_t* base;
+  BOOL trace;
+  /* what the runtime has allocated so far, JSMallocState only has what is held at the moment */
+  int64_t allocated_count, allocated_size;
+};
+
+static void* jsm_trace_malloc(JSMallocState*, size_t);
+
+/* the allocator's counters, for measuring what a piece of code allocates */
+static JSValue
+jsm_memory_usage(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  JSRuntime* rt = JS_GetRuntime(ctx);
+  JSMemoryUsage stats;
+  JSValue ret = JS_NewObject(ctx);
+
+  /* the totals are only counted with --count-allocs (or --trace) */
+  if(rt->mf.js_malloc == jsm_trace_malloc) {
+    struct trace_malloc_data* dp = rt->malloc_state.opaque;
+
+    JS_SetPropertyStr(ctx, ret, "allocatedSize", JS_NewInt64(ctx, dp->allocated_size));
+    JS_SetPropertyStr(ctx, ret, "allocatedCount", JS_NewInt64(ctx, dp->allocated_count));
+  }
+
+  JS_ComputeMemoryUsage(rt, &stats);
+  JS_SetPropertyStr(ctx, ret, "mallocSize", JS_NewInt64(ctx, stats.malloc_size));
+  JS_SetPropertyStr(ctx, ret, "mallocCount", JS_NewInt64(ctx, stats.malloc_count));
+  JS_SetPropertyStr(ctx, ret, "memoryUsedSize", JS_NewInt64(ctx, stats.memory_used_size));
+  JS_SetPropertyStr(ctx, ret, "memoryUsedCount", JS_NewInt64(ctx, stats.memory_used_count));
+  return ret;
+}
+
 static void
 jsm_dump_obj(JSContext* ctx, FILE* f, JSValueConst val) {
   const char* str;
@@ -469,10 +502,6 @@ JS_NewCustomContext(JSRuntime* rt) {
 #define MALLOC_OVERHEAD 8
 #endif
 
-struct trace_malloc_data {
-  uint8_t* base;
-};
-
 static inline unsigned long long
 jsm_trace_malloc_ptr_offset(uint8_t* ptr, struct trace_malloc_data* dp) {
   return ptr - dp->base;
@@ -503,9 +532,14 @@ static void
     __attribute__((format(printf, 2, 3)))
 #endif
     jsm_trace_malloc_printf(JSMallocState* s, const char* fmt, ...) {
+  struct trace_malloc_data* dp = s->opaque;
   va_list ap;
   int c;
 
+  /* with only --count-allocs nothing is printed */
+  if(!dp->trace)
+    return;
+
   va_start(ap, fmt);
   while((c = *fmt++) != '\0') {
     if(c == '%') {
@@ -551,6 +585,8 @@ jsm_trace_malloc(JSMallocState* s, size_t size) {
   if(ptr) {
     s->malloc_count++;
     s->malloc_size += jsm_trace_malloc_usable_size(ptr) + MALLOC_OVERHEAD;
+    ((struct trace_malloc_data*)s->opaque)->allocated_count++;
+    ((struct trace_malloc_data*)s->opaque)->allocated_size += size;
   }
   return ptr;
 }
@@ -592,6 +628,13 @@ jsm_trace_realloc(JSMallocState* s, void* ptr, size_t size) {
   jsm_trace_malloc_printf(s, " -> %p\n", ptr);
   if(ptr) {
     s->malloc_size += jsm_trace_malloc_usable_size(ptr) - old_size;
+    /* a growing realloc counts as an allocation of the difference */
+    if(size > old_size) {
+      struct trace_malloc_data* dp = s->opaque;
+
+      dp->allocated_count++;
+      dp->allocated_size += size - old_size;
+    }
   }
   return ptr;
 }
@@ -633,6 +676,7 @@ jsm_help(void) {
          "    --qjscalc      load the QJSCalc runtime (default if invoked as qjscalc)\n"
 #endif
          "-T  --trace        trace memory allocation\n"
+         "    --count-allocs count allocations for getMemoryUsage()\n"
          "-d  --dump         dump the memory usage stats\n"
          "    --memory-limit n       limit the memory usage to 'n' bytes\n"
          "    --stack-size n         limit the stack size to 'n' bytes\n"
@@ -769,6 +813,7 @@ static const JSCFunctionListEntry jsm_global_funcs[] = {
     JS_CFUNC_MAGIC_DEF("evalFile", 1, js_eval_script, 0),
     JS_CFUNC_MAGIC_DEF("evalScript", 1, js_eval_script, 1),
     JS_CGETSET_DEF("moduleList", jsm_module_list, 0),
+    JS_CFUNC_DEF("getMemoryUsage", 0, jsm_memory_usage),
     JS_CFUNC_MAGIC_DEF("findModule", 1, js_module_func, FIND_MODULE),
     JS_CFUNC_MAGIC_DEF("getModuleName", 1, js_module_func, GET_MODULE_NAME),
     JS_CFUNC_MAGIC_DEF("getModuleObject", 1, js_module_func, GET_MODULE_OBJECT),
@@ -789,6 +834,7 @@ main(int argc, char** argv) {
   int interactive = 0;
   int dump_memory = 0;
   int trace_memory = 0;
+  int count_allocs = 0;
   int empty_run = 0;
   int module = 1;
   int load_std = 1;
@@ -889,6 +935,10 @@ main(int argc, char** argv) {
         trace_memory++;
         break;
       }
+      if(!strcmp(longopt, "count-allocs")) {
+        count_allocs = 1;
+        break;
+      }
       if(!strcmp(longopt, "std")) {
         load_std = 1;
         break;
@@ -944,7 +994,9 @@ main(int argc, char** argv) {
   if(load_jscalc)
     bignum_ext = 1;
 
-  if(trace_memory) {
+  /* the trace functions also count what is allocated for getMemoryUsage(), they only print with --trace */
+  if(trace_memory || count_allocs) {
+    trace_data.trace = !!trace_memory;
     jsm_trace_malloc_init(&trace_data);
     rt = JS_NewRuntime2(&trace_mf, &trace_data);
   } else {
@@ -131,7 +131,7 @@ js_deep_iterator_new(JSContext* ctx, JSValueConst proto, JSValueConst root, JSVa
   if(!(it = js_mallocz(ctx, sizeof(DeepIterator))))
     return JS_EXCEPTION;
 
-  vector_init(&it->frames, ctx);
+  vector_init_rt(&it->frames, JS_GetRuntime(ctx));
 
   it->pred = JS_UNDEFINED;
   // it->type_mask = TYPE_ALL;
@@ -232,7 +232,11 @@ static void
 js_deep_iterator_finalizer(JSRuntime* rt, JSValue val) {
   DeepIterator* it = JS_GetOpaque(val, js_deep_iterator_class_id);
   if(it) {
-    // property_enumeration_free(&it->frames, rt);
+    property_enumeration_free(&it->frames, rt);
+    vector_free(&it->frames);
+    JS_FreeValueRT(rt, it->root);
+    JS_FreeValueRT(rt, it->pred);
+    js_free_rt(rt, it);
   }
 }
 
@@ -484,6 +488,200 @@ js_deep_flatten(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* a
   return ret;
 }
 
+typedef struct DeepStringTable {
+  JSAtom* atoms;
+  int32_t* index;
+  uint32_t count, size; /* open addressing, size is a power of 2 */
+} DeepStringTable;
+
+static inline uint32_t
+js_deep_strtab_slot(DeepStringTable* tab, JSAtom atom) {
+  uint32_t i = (atom * 0x9e3779b1u) & (tab->size - 1);
+
+  while(tab->atoms[i] != JS_ATOM_NULL && tab->atoms[i] != atom) i = (i + 1) & (tab->size - 1);
+  return i;
+}
+
+/* returns the index of the string in 'strings', appending it if it is new */
+static int32_t
+js_deep_strtab_put(JSContext* ctx, DeepStringTable* tab, JSValueConst strings, JSValueConst str) {
+  JSAtom atom;
+  uint32_t i;
+
+  if((tab->count + 1) * 2 > tab->size) {
+    JSAtom* old_atoms = tab->atoms;
+    int32_t* old_index = tab->index;
+    uint32_t j, old_size = tab->size;
+
+    tab->size = old_size ? old_size * 2 : 256;
+    tab->atoms = js_mallocz(ctx, sizeof(JSAtom) * tab->size);
+    tab->index = js_mallocz(ctx, sizeof(int32_t) * tab->size);
+
+    if(!tab->atoms || !tab->index) {
+      js_free(ctx, tab->atoms);
+      js_free(ctx, tab->index);
+      tab->atoms = old_atoms;
+      tab->index = old_index;
+      tab->size = old_size;
+      JS_ThrowOutOfMemory(ctx);
+      return -1;
+    }
+
+    for(j = 0; j < old_size; j++) {
+      if(old_atoms[j] != JS_ATOM_NULL) {
+        i = js_deep_strtab_slot(tab, old_atoms[j]);
+        tab->atoms[i] = old_atoms[j];
+        tab->index[i] = old_index[j];
+      }
+    }
+
+    js_free(ctx, old_atoms);
+    js_free(ctx, old_index);
+  }
+
+  if((atom = JS_ValueToAtom(ctx, str)) == JS_ATOM_NULL)
+    return -1;
+
+  i = js_deep_strtab_slot(tab, atom);
+
+  if(tab->atoms[i] != JS_ATOM_NULL) {
+    JS_FreeAtom(ctx, atom);
+  } else {
+    tab->atoms[i] = atom;
+    tab->index[i] = tab->count++;
+    JS_SetPropertyUint32(ctx, strings, tab->index[i], JS_DupValue(ctx, str));
+  }
+
+  return tab->index[i];
+}
+
+static void
+js_deep_strtab_free(JSContext* ctx, DeepStringTable* tab) {
+  uint32_t i;
+
+  for(i = 0; i < tab->size; i++)
+    if(tab->atoms[i] != JS_ATOM_NULL)
+      JS_FreeAtom(ctx, tab->atoms[i]);
+
+  js_free(ctx, tab->atoms);
+  js_free(ctx, tab->index);
+}
+
+static JSValue
+js_deep_flatten_columns(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv) {
+  Vector frames = VECTOR(ctx), ids = VECTOR(ctx), parents = VECTOR(ctx), types = VECTOR(ctx), numbers = VECTOR(ctx),
+         stridx = VECTOR(ctx);
+  DeepStringTable strtab = {0, 0, 0, 0};
+  PropertyEnumeration* it;
+  JSValue ret, keys, strings;
+  int32_t id = -1;
+  uint32_t n = 0;
+
+  if(!JS_IsObject(argv[0]))
+    return JS_ThrowTypeError(ctx, "argument 1 (root) is not an object");
+
+  keys = JS_NewArray(ctx);
+  strings = JS_NewArray(ctx);
+
+  /* 'ids' holds the node id of the object each frame enumerates, -1 for the root */
+  vector_push(&ids, id);
+
+  it = property_enumeration_push(&frames, ctx, JS_DupValue(ctx, argv[0]), PROPENUM_DEFAULT_FLAGS);
+  do {
+    uint32_t depth = property_enumeration_depth(&frames);
+    JSValue value;
+    int32_t parent, type, str = -1;
+    BOOL is_string = FALSE;
+    double num = NAN;
+
+    if(!property_enumeration_length(it))
+      continue;
+
+    while(vector_size(&ids, sizeof(int32_t)) > depth) vector_pop(&ids, sizeof(int32_t));
+
+    /* a new frame has been entered from the previous node */
+    if(vector_size(&ids, sizeof(int32_t)) < depth) {
+      id = n - 1;
+      vector_push(&ids, id);
+    }
+
+    parent = *(int32_t*)vector_back(&ids, sizeof(int32_t));
+    value = property_enumeration_value(it, ctx);
+
+    /* a getter threw */
+    if(JS_IsException(value))
+      goto fail;
+
+    if((type = js_value_type_get(ctx, value)) < 0) {
+      JS_FreeValue(ctx, value);
+      JS_ThrowTypeError(ctx, "flattenColumns: value of unknown type");
+      goto fail;
+    }
+
+    if(JS_SetPropertyUint32(ctx, keys, n, property_enumeration_key(it, ctx)) < 0) {
+      JS_FreeValue(ctx, value);
+      goto fail;
+    }
+
+    switch(JS_VALUE_GET_TAG(value)) {
+      case JS_TAG_INT:
+      case JS_TAG_FLOAT64: JS_ToFloat64(ctx, &num, value); break;
+      case JS_TAG_BOOL: num = JS_VALUE_GET_BOOL(value) ? 1 : 0; break;
+      case JS_TAG_STRING:
+        is_string = TRUE;
+        str = js_deep_strtab_put(ctx, &strtab, strings, value);
+        break;
+      case JS_TAG_BIG_INT:
+      case JS_TAG_BIG_FLOAT:
+      case JS_TAG_BIG_DECIMAL: {
+        JSValue s = JS_ToString(ctx, value);
+        is_string = TRUE;
+        str = JS_IsException(s) ? -1 : js_deep_strtab_put(ctx, &strtab, strings, s);
+        JS_FreeValue(ctx, s);
+        break;
+      }
+      default: break;
+    }
+    JS_FreeValue(ctx, value);
+
+    if(is_string && str < 0)
+      goto fail;
+
+    vector_push(&parents, parent);
+    vector_push(&types, (uint8_t){type});
+    vector_push(&numbers, num);
+    vector_push(&stridx, str);
+    n++;
+
+  } while((it = property_enumeration_recurse(&frames, ctx)));
+
+  ret = JS_NewObject(ctx);
+  JS_SetPropertyStr(ctx, ret, "length", JS_NewUint32(ctx, n));
+  JS_SetPropertyStr(ctx, ret, "parent", js_typedarray_new(ctx, "Int32Array", parents.data, parents.size));
+  JS_SetPropertyStr(ctx, ret, "key", keys);
+  JS_SetPropertyStr(ctx, ret, "type", js_typedarray_new(ctx, "Uint8Array", types.data, types.size));
+  JS_SetPropertyStr(ctx, ret, "number", js_typedarray_new(ctx, "Float64Array", numbers.data, numbers.size));
+  JS_SetPropertyStr(ctx, ret, "string", js_typedarray_new(ctx, "Int32Array", stridx.data, stridx.size));
+  JS_SetPropertyStr(ctx, ret, "strings", strings);
+
+end:
+  property_enumeration_free(&frames, JS_GetRuntime(ctx));
+  vector_free(&frames);
+  vector_free(&ids);
+  vector_free(&parents);
+  vector_free(&types);
+  vector_free(&numbers);
+  vector_free(&stridx);
+  js_deep_strtab_free(ctx, &strtab);
+  return ret;
+
+fail:
+  JS_FreeValue(ctx, keys);
+  JS_FreeValue(ctx, strings);
+  ret = JS_EXCEPTION;
+  goto end;
+}
+
 static JSValue
 js_deep_pathof(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv) {
   JSValue ret = JS_UNDEFINED;
@@ -548,65 +746,879 @@ js_deep_foreach(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* a
   return JS_UNDEFINED;
 }
 
+enum {
+  FOREACH_ITERATOR = 0,
+  FOREACH_FN,
+  FOREACH_THIS_ARG,
+  FOREACH_RESOLVE,
+  FOREACH_REJECT,
+  FOREACH_TYPE_MASK,
+  FOREACH_BUDGET,
+  FOREACH_NDATA,
+};
+
+static JSValue js_deep_foreach_slice(JSContext*, JSValueConst, int, JSValueConst*, int, JSValue*);
+
 static JSValue
-js_deep_equals(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv) {
-  JSValue ret = JS_TRUE;
-  PropertyEnumeration *aenum, *benum;
-  Vector aframes, bframes;
+js_deep_foreach_job(JSContext* ctx, int argc, JSValueConst* argv) {
+  return JS_Call(ctx, argv[0], JS_UNDEFINED, 0, 0);
+}
 
-  vector_init(&aframes, ctx);
-  vector_init(&bframes, ctx);
+static void
+js_deep_foreach_schedule(JSContext* ctx, JSValueConst data[]) {
+  JSValue slice, set_timeout;
 
-  aenum =
-      property_enumeration_push(&aframes, ctx, JS_DupValue(ctx, argv[0]), PROPENUM_DEFAULT_FLAGS | PROPENUM_SORT_ATOMS);
-  benum =
-      property_enumeration_push(&bframes, ctx, JS_DupValue(ctx, argv[1]), PROPENUM_DEFAULT_FLAGS | PROPENUM_SORT_ATOMS);
-  do {
-    JSValue aval, bval;
-    JSAtom akey, bkey;
-    const char *astr, *bstr, *avstr, *bvstr;
-    BOOL result = TRUE;
+  slice = JS_NewCFunctionData(ctx, js_deep_foreach_slice, 0, 0, FOREACH_NDATA, (JSValueConst*)data);
+  set_timeout = js_global_get(ctx, "setTimeout");
 
-    if(!aenum || !benum) {
-      ret = JS_FALSE;
+  /* prefer a timer so pending I/O gets a turn, fall back to the job queue */
+  if(JS_IsFunction(ctx, set_timeout)) {
+    JSValueConst args[] = {slice, JS_NewInt32(ctx, 0)};
+    JS_FreeValue(ctx, JS_Call(ctx, set_timeout, JS_UNDEFINED, 2, args));
+  } else {
+    JS_EnqueueJob(ctx, js_deep_foreach_job, 1, &slice);
+  }
+
+  JS_FreeValue(ctx, set_timeout);
+  JS_FreeValue(ctx, slice);
+}
+
+static JSValue
+js_deep_foreach_slice(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv, int magic, JSValue* data) {
+  DeepIterator* it;
+  PropertyEnumeration* penum;
+  uint32_t type_mask, count = 0;
+  uint64_t deadline;
+  double budget;
+
+  if(!(it = JS_GetOpaque2(ctx, data[FOREACH_ITERATOR], js_deep_iterator_class_id)))
+    return JS_EXCEPTION;
+
+  JS_ToUint32(ctx, &type_mask, data[FOREACH_TYPE_MASK]);
+  JS_ToFloat64(ctx, &budget, data[FOREACH_BUDGET]);
+  deadline = time_us() + (uint64_t)(budget * 1000);
+
+  /* the frames always point at the next node to visit */
+  while(!vector_empty(&it->frames)) {
+    penum = vector_back(&it->frames, sizeof(PropertyEnumeration));
+
+    if(property_enumeration_length(penum)) {
+      JSValueConst args[3] = {property_enumeration_value(penum, ctx), JS_UNDEFINED, it->root};
+      JSValue ret = JS_UNDEFINED;
+
+      if(js_value_type(ctx, args[0]) & type_mask) {
+        args[1] = property_enumeration_path(&it->frames, ctx);
+        ret = JS_Call(ctx, data[FOREACH_FN], data[FOREACH_THIS_ARG], 3, args);
+        JS_FreeValue(ctx, args[1]);
+      }
+      JS_FreeValue(ctx, args[0]);
+
+      if(JS_IsException(ret)) {
+        JSValue error = JS_GetException(ctx);
+        JS_FreeValue(ctx, JS_Call(ctx, data[FOREACH_REJECT], JS_UNDEFINED, 1, &error));
+        JS_FreeValue(ctx, error);
+        property_enumeration_free(&it->frames, JS_GetRuntime(ctx));
+        vector_clear(&it->frames);
+        return JS_UNDEFINED;
+      }
+      JS_FreeValue(ctx, ret);
+    }
+
+    if(!property_enumeration_recurse(&it->frames, ctx))
       break;
+
+    if((++count & 0x3f) == 0 && time_us() >= deadline) {
+      js_deep_foreach_schedule(ctx, data);
+      return JS_UNDEFINED;
+    }
+  }
+
+  JS_FreeValue(ctx, JS_Call(ctx, data[FOREACH_RESOLVE], JS_UNDEFINED, 0, 0));
+  return JS_UNDEFINED;
+}
+
+static JSValue
+js_deep_foreach_async(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv) {
+  JSValue promise, iter, resolving_funcs[2];
+  JSValueConst data[FOREACH_NDATA];
+  uint32_t type_mask = TYPE_ALL;
+  double budget = 10;
+  DeepIterator* it;
+
+  if(!JS_IsFunction(ctx, argv[1]))
+    return JS_ThrowTypeError(ctx, "argument 2 (callback) is not a function");
+
+  if(argc > 3)
+    JS_ToUint32(ctx, &type_mask, argv[3]);
+
+  if(argc > 4) {
+    if(JS_IsNumber(argv[4])) {
+      JS_ToFloat64(ctx, &budget, argv[4]);
+    } else if(JS_IsObject(argv[4])) {
+      JSValue value = JS_GetPropertyStr(ctx, argv[4], "budgetMs");
+      if(JS_IsNumber(value))
+        JS_ToFloat64(ctx, &budget, value);
+      JS_FreeValue(ctx, value);
+    }
+  }
+
+  iter = js_deep_iterator_new(ctx, deep_iterator_proto, argv[0], JS_UNDEFINED, 0);
+  if(JS_IsException(iter))
+    return iter;
+
+  promise = JS_NewPromiseCapability(ctx, resolving_funcs);
+  if(JS_IsException(promise)) {
+    JS_FreeValue(ctx, iter);
+    return promise;
+  }
+
+  it = JS_GetOpaque(iter, js_deep_iterator_class_id);
+  if(JS_IsObject(argv[0]))
+    property_enumeration_push(&it->frames, ctx, JS_DupValue(ctx, argv[0]), PROPENUM_DEFAULT_FLAGS);
+
+  data[FOREACH_ITERATOR] = iter;
+  data[FOREACH_FN] = argv[1];
+  data[FOREACH_THIS_ARG] = argc > 2 ? argv[2] : JS_UNDEFINED;
+  data[FOREACH_RESOLVE] = resolving_funcs[0];
+  data[FOREACH_REJECT] = resolving_funcs[1];
+  data[FOREACH_TYPE_MASK] = JS_NewUint32(ctx, type_mask);
+  data[FOREACH_BUDGET] = JS_NewFloat64(ctx, budget);
+
+  /* the first slice is deferred as well, so the caller always gets the promise first */
+  js_deep_foreach_schedule(ctx, data);
+
+  JS_FreeValue(ctx, iter);
+  JS_FreeValue(ctx, resolving_funcs[0]);
+  JS_FreeValue(ctx, resolving_funcs[1]);
+  return promise;
+}
+
+static void
+js_deep_propenum_free(JSContext* ctx, JSPropertyEnum* tab, uint32_t len) {
+  uint32_t i;
+  if(tab) {
+    for(i = 0; i < len; i++) JS_FreeAtom(ctx, tab[i].atom);
+    js_free(ctx, tab);
+  }
+}
+
+static inline uint32_t
+js_deep_string_char(const JSString* str, uint32_t i) {
+  return str->is_wide_char ? str->u.str16[i] : str->u.str8[i];
+}
+
+static BOOL
+js_deep_string_equals(const JSString* a, const JSString* b) {
+  uint32_t i;
+
+  if(a == b)
+    return TRUE;
+  if(a->len != b->len)
+    return FALSE;
+  if(a->is_wide_char == b->is_wide_char)
+    return !memcmp(a->u.str8, b->u.str8, a->len << a->is_wide_char);
+
+  for(i = 0; i < a->len; i++)
+    if(js_deep_string_char(a, i) != js_deep_string_char(b, i))
+      return FALSE;
+  return TRUE;
+}
+
+/* drops the array indices from 'tab', the elements of fast arrays are handled separately */
+static uint32_t
+js_deep_propenum_noindex(JSPropertyEnum* tab, uint32_t len) {
+  uint32_t i, j;
+
+  for(i = 0, j = 0; i < len; i++) {
+    if(js_atom_isint(tab[i].atom))
+      continue;
+    tab[j++] = tab[i];
+  }
+  return j;
+}
+
+static int js_deep_equal_values(JSContext*, JSValueConst, JSValueConst, Vector*);
+
+/* snapshot of the [key, value] records of a Map or Set, getters could modify it while it is visited */
+static void
+js_deep_map_entries(JSContext* ctx, JSObject* p, Vector* entries) {
+  struct list_head* el;
+
+  list_for_each(el, &p->u.map_state->records) {
+    JSMapRecord* mr = list_entry(el, JSMapRecord, link);
+    JSValue kv[2];
+
+    if(mr->empty)
+      continue;
+
+    kv[0] = JS_DupValue(ctx, mr->key);
+    kv[1] = JS_DupValue(ctx, mr->value);
+    vector_put(entries, kv, sizeof(kv));
+  }
+}
+
+static void
+js_deep_map_entries_free(JSContext* ctx, Vector* entries) {
+  JSValue* entry;
+
+  vector_foreach_t(entries, entry) JS_FreeValue(ctx, *entry);
+  vector_free(entries);
+}
+
+/* classes whose primitive is kept in u.object_data */
+static BOOL
+js_deep_has_object_data(JSObject* p) {
+  switch(p->class_id) {
+    case JS_CLASS_NUMBER:
+    case JS_CLASS_STRING:
+    case JS_CLASS_BOOLEAN:
+    case JS_CLASS_SYMBOL:
+#ifdef CONFIG_BIGNUM
+    case JS_CLASS_BIG_INT:
+    case JS_CLASS_BIG_FLOAT:
+    case JS_CLASS_BIG_DECIMAL:
+#endif
+    case JS_CLASS_DATE: return TRUE;
+    default: break;
+  }
+  return FALSE;
+}
+
+/* compares the state which isn't visible as properties: the primitive of Date and boxed values, the entries of Map and Set (in order) */
+static int
+js_deep_equal_internal(JSContext* ctx, JSObject* a, JSObject* b, Vector* pairs) {
+  Vector ea = VECTOR(ctx), eb = VECTOR(ctx);
+  JSValue *x, *y;
+  int ret = 1;
+
+  if(js_deep_has_object_data(a))
+    return js_deep_equal_values(ctx, a->u.object_data, b->u.object_data, pairs);
+
+  if(a->class_id != JS_CLASS_MAP && a->class_id != JS_CLASS_SET)
+    return 1;
+
+  js_deep_map_entries(ctx, a, &ea);
+  js_deep_map_entries(ctx, b, &eb);
+
+  if(ea.size != eb.size)
+    ret = 0;
+
+  for(x = vector_begin(&ea), y = vector_begin(&eb); ret > 0 && x != vector_end(&ea); x++, y++)
+    ret = js_deep_equal_values(ctx, *x, *y, pairs);
+
+  js_deep_map_entries_free(ctx, &ea);
+  js_deep_map_entries_free(ctx, &eb);
+  return ret;
+}
+
+/* returns 1 when equal, 0 when not and -1 on exception */
+static int
+js_deep_equal_objects(JSContext* ctx, JSValueConst a, JSValueConst b, Vector* pairs) {
+  JSObject *aobj = JS_VALUE_GET_OBJ(a), *bobj = JS_VALUE_GET_OBJ(b), **pair;
+  JSPropertyEnum *atoms_a = 0, *atoms_b = 0;
+  uint32_t i, natoms_a = 0, natoms_b = 0;
+  int32_t n, ia = -1, ib = -1;
+  BOOL is_fast;
+  int ret = 0;
+
+  /* below the top, identical objects can still differ in where their cycles lead */
+  if(aobj == bobj && vector_empty(pairs))
+    return 1;
+  if(aobj->class_id != bobj->class_id)
+    return 0;
+  if(JS_IsFunction(ctx, a))
+    return aobj == bobj;
+
+  /* a cycle on one side must lead back to the same level on the other side, like the hash does */
+  for(pair = vector_begin(pairs), n = 0; pair != vector_end(pairs); pair += 2, n++) {
+    if(pair[0] == aobj)
+      ia = n;
+    if(pair[1] == bobj)
+      ib = n;
+  }
+  if(ia != -1 || ib != -1)
+    return ia == ib;
+
+  vector_push(pairs, aobj);
+  vector_push(pairs, bobj);
+
+  if((ret = js_deep_equal_internal(ctx, aobj, bobj, pairs)) <= 0)
+    goto end;
+  ret = 0;
+
+  /* elements of fast arrays are compared directly, the other own properties below */
+  if((is_fast = aobj->class_id == JS_CLASS_ARRAY && aobj->fast_array && bobj->fast_array)) {
+    if(aobj->u.array.count != bobj->u.array.count)
+      goto end;
+
+    for(i = 0; i < aobj->u.array.count; i++) {
+      JSValue aval, bval;
+      int result;
+
+      /* getters further down may have modified the arrays */
+      if(!aobj->fast_array || !bobj->fast_array || i >= bobj->u.array.count)
+        goto end;
+
+      aval = JS_DupValue(ctx, aobj->u.array.u.values[i]);
+      bval = JS_DupValue(ctx, bobj->u.array.u.values[i]);
+      result = js_deep_equal_values(ctx, aval, bval, pairs);
+      JS_FreeValue(ctx, aval);
+      JS_FreeValue(ctx, bval);
+
+      if(result <= 0) {
+        ret = result;
+        goto end;
+      }
     }
+  }
+
+  if(JS_GetOwnPropertyNames(ctx, &atoms_a, &natoms_a, a, PROPENUM_DEFAULT_FLAGS) ||
+     JS_GetOwnPropertyNames(ctx, &atoms_b, &natoms_b, b, PROPENUM_DEFAULT_FLAGS)) {
+    ret = -1;
+    goto end;
+  }
+
+  if(is_fast) {
+    natoms_a = js_deep_propenum_noindex(atoms_a, natoms_a);
+    natoms_b = js_deep_propenum_noindex(atoms_b, natoms_b);
+  }
 
-    akey = aenum->tab_atom[aenum->idx].atom;
-    bkey = benum->tab_atom[benum->idx].atom;
+  if(natoms_a != natoms_b)
+    goto end;
 
-    aval = property_enumeration_value(aenum, ctx);
-    bval = property_enumeration_value(benum, ctx);
+  qsort(atoms_a, natoms_a, sizeof(JSPropertyEnum), (int (*)(const void*, const void*)) & compare_jspropertyenum);
+  qsort(atoms_b, natoms_b, sizeof(JSPropertyEnum), (int (*)(const void*, const void*)) & compare_jspropertyenum);
 
-    astr = JS_AtomToCString(ctx, akey);
-    bstr = JS_AtomToCString(ctx, bkey);
-    avstr = JS_ToCString(ctx, aval);
-    bvstr = JS_ToCString(ctx, bval);
+  for(i = 0; i < natoms_a; i++)
+    if(atoms_a[i].atom != atoms_b[i].atom)
+      goto end;
 
-    if(JS_IsObject(aval) && JS_IsObject(bval))
-      result = TRUE;
-    else
-      result = js_value_equals(ctx, aval, bval);
+  for(i = 0; i < natoms_a; i++) {
+    JSValue aval, bval;
+    int result = -1;
 
+    aval = JS_GetProperty(ctx, a, atoms_a[i].atom);
+    bval = JS_GetProperty(ctx, b, atoms_b[i].atom);
+    if(!JS_IsException(aval) && !JS_IsException(bval))
+      result = js_deep_equal_values(ctx, aval, bval, pairs);
     JS_FreeValue(ctx, aval);
     JS_FreeValue(ctx, bval);
 
-    // printf("a %s: %s b %s: %s result: %d\n", astr, avstr, bstr, bvstr, result);
+    if(result <= 0) {
+      ret = result;
+      goto end;
+    }
+  }
+  ret = 1;
 
-    JS_FreeCString(ctx, astr);
-    JS_FreeCString(ctx, bstr);
-    JS_FreeCString(ctx, avstr);
-    JS_FreeCString(ctx, bvstr);
+end:
+  js_deep_propenum_free(ctx, atoms_a, natoms_a);
+  js_deep_propenum_free(ctx, atoms_b, natoms_b);
+  vector_pop(pairs, sizeof(JSObject*));
+  vector_pop(pairs, sizeof(JSObject*));
+  return ret;
+}
 
-    if(!result) {
-      ret = JS_FALSE;
+static int
+js_deep_equal_values(JSContext* ctx, JSValueConst a, JSValueConst b, Vector* pairs) {
+  int32_t tag = JS_VALUE_GET_TAG(a);
+
+  if(JS_IsNumber(a) && JS_IsNumber(b)) {
+    double x, y;
+    JS_ToFloat64(ctx, &x, a);
+    JS_ToFloat64(ctx, &y, b);
+    return x == y || (isnan(x) && isnan(y));
+  }
+
+  if(tag != JS_VALUE_GET_TAG(b))
+    return 0;
+
+  switch(tag) {
+    case JS_TAG_UNDEFINED:
+    case JS_TAG_NULL: return 1;
+    case JS_TAG_BOOL: return !JS_VALUE_GET_BOOL(a) == !JS_VALUE_GET_BOOL(b);
+    case JS_TAG_STRING: return js_deep_string_equals(JS_VALUE_GET_PTR(a), JS_VALUE_GET_PTR(b));
+    case JS_TAG_SYMBOL: return JS_VALUE_GET_PTR(a) == JS_VALUE_GET_PTR(b);
+    case JS_TAG_OBJECT: return js_deep_equal_objects(ctx, a, b, pairs);
+    default: break;
+  }
+
+  return JS_VALUE_GET_PTR(a) == JS_VALUE_GET_PTR(b) || js_value_equals(ctx, a, b);
+}
+
+static JSValue
+js_deep_equals(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv) {
+  Vector pairs;
+  int ret;
+
+  vector_init(&pairs, ctx);
+  ret = js_deep_equal_values(ctx, argv[0], argv[1], &pairs);
+  vector_free(&pairs);
+
+  return ret < 0 ? JS_EXCEPTION : JS_NewBool(ctx, ret);
+}
+
+#define DEEP_HASH_INIT 0xcbf29ce484222325ull
+#define DEEP_HASH_PRIME 0x100000001b3ull
+
+static inline uint64_t
+js_deep_hash_bytes(uint64_t h, const void* ptr, size_t len) {
+  const uint8_t* p = ptr;
+  while(len--) {
+    h ^= *p++;
+    h *= DEEP_HASH_PRIME;
+  }
+  return h;
+}
+
+static inline uint64_t
+js_deep_hash_mix(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ull;
+  h ^= h >> 33;
+  return h;
+}
+
+static uint64_t
+js_deep_hash_string(uint64_t h, const JSString* str) {
+  uint32_t i;
+
+  h = js_deep_hash_bytes(h, "s", 1);
+  h = js_deep_hash_bytes(h, &(uint32_t){str->len}, sizeof(uint32_t));
+
+  if(!str->is_wide_char)
+    return js_deep_hash_bytes(h, str->u.str8, str->len);
+
+  /* 16-bit strings hash identical to their 8-bit equivalents */
+  for(i = 0; i < str->len; i++) {
+    uint16_t c = str->u.str16[i];
+    h = js_deep_hash_bytes(h, &c, c > 0xff ? 2 : 1);
+  }
+  return h;
+}
+
+/* the objects being hashed, a cycle is hashed as the distance to the object it leads back to */
+typedef struct DeepHash {
+  Vector stack;
+  BOOL exception;
+} DeepHash;
+
+static uint64_t js_deep_hash_value(JSContext*, uint64_t, JSValueConst, DeepHash*);
+
+static uint64_t
+js_deep_hash_atom(JSContext* ctx, uint64_t h, JSAtom atom, DeepHash* dh) {
+  JSValue key;
+
+  if(js_atom_isint(atom)) {
+    uint32_t idx = js_atom_toint(atom);
+    h = js_deep_hash_bytes(h, "i", 1);
+    return js_deep_hash_bytes(h, &idx, sizeof(idx));
+  }
+
+  key = JS_AtomToValue(ctx, atom);
+  h = js_deep_hash_value(ctx, h, key, dh);
+  JS_FreeValue(ctx, key);
+  return h;
+}
+
+/* adds the own properties of 'obj' to 'sum', leaving out the indices for fast arrays */
+static uint32_t
+js_deep_hash_properties(JSContext* ctx, uint64_t* sum, JSValueConst obj, BOOL skip_indices, DeepHash* dh) {
+  JSPropertyEnum* tab = 0;
+  uint32_t i, len = 0;
+
+  if(JS_GetOwnPropertyNames(ctx, &tab, &len, obj, PROPENUM_DEFAULT_FLAGS)) {
+    dh->exception = TRUE;
+    return 0;
+  }
+
+  for(i = 0; i < len && !dh->exception; i++) {
+    JSValue value;
+    uint64_t ph;
+
+    if(skip_indices && js_atom_isint(tab[i].atom))
+      continue;
+
+    if(JS_IsException((value = JS_GetProperty(ctx, obj, tab[i].atom)))) {
+      dh->exception = TRUE;
       break;
     }
-  } while(
-      ((aenum = property_enumeration_recurse(&aframes, ctx)), (benum = property_enumeration_recurse(&bframes, ctx))));
 
-  property_enumeration_free(&aframes, JS_GetRuntime(ctx));
-  property_enumeration_free(&bframes, JS_GetRuntime(ctx));
+    ph = js_deep_hash_atom(ctx, DEEP_HASH_INIT, tab[i].atom, dh);
+    *sum += js_deep_hash_mix(js_deep_hash_value(ctx, ph, value, dh));
+    JS_FreeValue(ctx, value);
+  }
+
+  js_deep_propenum_free(ctx, tab, len);
+  return len;
+}
+
+static uint64_t
+js_deep_hash_object(JSContext* ctx, uint64_t h, JSValueConst obj, DeepHash* dh) {
+  JSObject *p = JS_VALUE_GET_OBJ(obj), **ptr;
+  uint32_t i, len = 0;
+  uint64_t sum = 0;
+
+  if(JS_IsFunction(ctx, obj)) {
+    h = js_deep_hash_bytes(h, "o", 1);
+    h = js_deep_hash_bytes(h, &p->class_id, sizeof(p->class_id));
+    return js_deep_hash_bytes(h, &p, sizeof(p));
+  }
+
+  vector_foreach_t(&dh->stack, ptr) if(*ptr == p) {
+      uint32_t distance = (JSObject**)vector_end(&dh->stack) - ptr;
+      h = js_deep_hash_bytes(h, "c", 1);
+      return js_deep_hash_bytes(h, &distance, sizeof(distance));
+    }
+
+  h = js_deep_hash_bytes(h, "o", 1);
+  h = js_deep_hash_bytes(h, &p->class_id, sizeof(p->class_id));
+
+  vector_push(&dh->stack, p);
+
+  /* state which isn't visible as properties, Map and Set entries are hashed in order */
+  if(js_deep_has_object_data(p)) {
+    h = js_deep_hash_value(ctx, h, p->u.object_data, dh);
+  } else if(p->class_id == JS_CLASS_MAP || p->class_id == JS_CLASS_SET) {
+    Vector entries = VECTOR(ctx);
+    JSValue* entry;
+
+    js_deep_map_entries(ctx, p, &entries);
+    vector_foreach_t(&entries, entry) if(!dh->exception) h = js_deep_hash_value(ctx, h, *entry, dh);
+    js_deep_map_entries_free(ctx, &entries);
+  }
+
+  /* properties are combined order-independently, so are array elements (their index is hashed as key) */
+  if(p->class_id == JS_CLASS_ARRAY && p->fast_array) {
+    for(i = 0; p->fast_array && i < p->u.array.count && !dh->exception; i++) {
+      JSValue value = JS_DupValue(ctx, p->u.array.u.values[i]);
+      uint64_t ph = js_deep_hash_atom(ctx, DEEP_HASH_INIT, js_atom_fromint(i), dh);
+      sum += js_deep_hash_mix(js_deep_hash_value(ctx, ph, value, dh));
+      JS_FreeValue(ctx, value);
+    }
+
+    /* plus the properties which aren't elements, the count is the same as for the slow path */
+    if(!dh->exception)
+      len = js_deep_hash_properties(ctx, &sum, obj, TRUE, dh);
+  } else {
+    len = js_deep_hash_properties(ctx, &sum, obj, FALSE, dh);
+  }
+
+  vector_pop(&dh->stack, sizeof(JSObject*));
+
+  h = js_deep_hash_bytes(h, &len, sizeof(len));
+  return js_deep_hash_bytes(h, &sum, sizeof(sum));
+}
+
+static uint64_t
+js_deep_hash_value(JSContext* ctx, uint64_t h, JSValueConst value, DeepHash* dh) {
+  int32_t tag = JS_VALUE_GET_TAG(value);
+
+  if(JS_IsNumber(value)) {
+    double d;
+    JS_ToFloat64(ctx, &d, value);
+    if(isnan(d))
+      d = NAN;
+    else if(d == 0)
+      d = 0;
+    h = js_deep_hash_bytes(h, "n", 1);
+    return js_deep_hash_bytes(h, &d, sizeof(d));
+  }
+
+  switch(tag) {
+    case JS_TAG_UNDEFINED: return js_deep_hash_bytes(h, "u", 1);
+    case JS_TAG_NULL: return js_deep_hash_bytes(h, "z", 1);
+    case JS_TAG_BOOL: return js_deep_hash_bytes(h, JS_VALUE_GET_BOOL(value) ? "t" : "f", 1);
+    case JS_TAG_STRING: return js_deep_hash_string(h, JS_VALUE_GET_PTR(value));
+    case JS_TAG_SYMBOL: return js_deep_hash_string(js_deep_hash_bytes(h, "y", 1), JS_VALUE_GET_PTR(value));
+    case JS_TAG_OBJECT: return js_deep_hash_object(ctx, h, value, dh);
+    default: break;
+  }
+
+  {
+    size_t len;
+    const char* str;
+    h = js_deep_hash_bytes(h, &tag, sizeof(tag));
+    if((str = JS_ToCStringLen(ctx, &len, value))) {
+      h = js_deep_hash_bytes(h, str, len);
+      JS_FreeCString(ctx, str);
+    }
+  }
+  return h;
+}
+
+static JSValue
+js_deep_hash(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv) {
+  DeepHash dh = {VECTOR(ctx), FALSE};
+  uint64_t h = js_deep_hash_value(ctx, DEEP_HASH_INIT, argv[0], &dh);
+
+  vector_free(&dh.stack);
+  return dh.exception ? JS_EXCEPTION : JS_NewBigUint64(ctx, h);
+}
+
+enum deep_op {
+  DEEP_OP_ADD = 0,
+  DEEP_OP_REMOVE,
+  DEEP_OP_REPLACE,
+};
+
+static const char* const js_deep_ops[] = {"add", "remove", "replace", 0};
+
+typedef struct DeepDiff {
+  Pointer ptr;
+  Vector pairs;
+  JSValue edits;
+  uint32_t index, flags;
+} DeepDiff;
+
+static void
+js_deep_diff_edit(JSContext* ctx, DeepDiff* diff, enum deep_op op, JSValueConst value) {
+  JSValue edit, path;
+
+  if(diff->flags & PATH_AS_STRING) {
+    DynBuf dbuf;
+    js_dbuf_init(ctx, &dbuf);
+    pointer_tostring(&diff->ptr, ctx, &dbuf);
+    path = JS_NewStringLen(ctx, (const char*)dbuf.buf, dbuf.size);
+    dbuf_free(&dbuf);
+  } else {
+    path = pointer_toarray(&diff->ptr, ctx);
+  }
+
+  edit = JS_NewArray(ctx);
+  JS_SetPropertyUint32(ctx, edit, 0, path);
+  JS_SetPropertyUint32(ctx, edit, 1, JS_NewString(ctx, js_deep_ops[op]));
+  if(op != DEEP_OP_REMOVE)
+    JS_SetPropertyUint32(ctx, edit, 2, JS_DupValue(ctx, value));
+
+  JS_SetPropertyUint32(ctx, diff->edits, diff->index++, edit);
+}
+
+static int js_deep_diff_values(JSContext*, DeepDiff*, JSValueConst, JSValueConst);
+
+/* returns -1 on exception */
+static int
+js_deep_diff_objects(JSContext* ctx, DeepDiff* diff, JSValueConst a, JSValueConst b) {
+  JSObject *aobj = JS_VALUE_GET_OBJ(a), *bobj = JS_VALUE_GET_OBJ(b), **pair;
+  JSPropertyEnum *atoms_a = 0, *atoms_b = 0;
+  uint32_t i = 0, j = 0, natoms_a = 0, natoms_b = 0;
+  int64_t alen = 0, blen = 0;
+  BOOL is_array = aobj->class_id == JS_CLASS_ARRAY;
+  int ret = -1;
+
+  if(aobj == bobj)
+    return 0;
+
+  for(pair = vector_begin(&diff->pairs); pair != vector_end(&diff->pairs); pair += 2)
+    if(pair[0] == aobj && pair[1] == bobj)
+      return 0;
+
+  vector_push(&diff->pairs, aobj);
+  vector_push(&diff->pairs, bobj);
+
+  if(JS_GetOwnPropertyNames(ctx, &atoms_a, &natoms_a, a, PROPENUM_DEFAULT_FLAGS) ||
+     JS_GetOwnPropertyNames(ctx, &atoms_b, &natoms_b, b, PROPENUM_DEFAULT_FLAGS))
+    goto end;
+
+  qsort(atoms_a, natoms_a, sizeof(JSPropertyEnum), (int (*)(const void*, const void*)) & compare_jspropertyenum);
+  qsort(atoms_b, natoms_b, sizeof(JSPropertyEnum), (int (*)(const void*, const void*)) & compare_jspropertyenum);
+
+  if(is_array) {
+    alen = js_array_length(ctx, a);
+    blen = js_array_length(ctx, b);
+  }
+
+  /* merge the sorted atom lists of both sides */
+  while(i < natoms_a || j < natoms_b) {
+    JSAtom aatom = i < natoms_a ? atoms_a[i].atom : JS_ATOM_NULL;
+    JSAtom batom = j < natoms_b ? atoms_b[j].atom : JS_ATOM_NULL;
+    int cmp = i == natoms_a ? 1 : j == natoms_b ? -1 : aatom < batom ? -1 : aatom > batom ? 1 : 0;
+
+    if(cmp < 0) {
+      /* elements beyond the new length are covered by the 'length' edit below */
+      if(!(is_array && js_atom_isint(aatom) && js_atom_toint(aatom) >= blen)) {
+        pointer_push(&diff->ptr, ctx, JS_DupAtom(ctx, aatom));
+        js_deep_diff_edit(ctx, diff, DEEP_OP_REMOVE, JS_UNDEFINED);
+        JS_FreeAtom(ctx, pointer_pop(&diff->ptr));
+      }
+      i++;
+    } else if(cmp > 0) {
+      JSValue bval = JS_GetProperty(ctx, b, batom);
+
+      if(JS_IsException(bval))
+        goto end;
+
+      pointer_push(&diff->ptr, ctx, JS_DupAtom(ctx, batom));
+      js_deep_diff_edit(ctx, diff, DEEP_OP_ADD, bval);
+      JS_FreeAtom(ctx, pointer_pop(&diff->ptr));
+      JS_FreeValue(ctx, bval);
+      j++;
+    } else {
+      JSValue aval = JS_GetProperty(ctx, a, aatom), bval = JS_GetProperty(ctx, b, batom);
+      int r = -1;
+
+      if(!JS_IsException(aval) && !JS_IsException(bval)) {
+        pointer_push(&diff->ptr, ctx, JS_DupAtom(ctx, aatom));
+        r = js_deep_diff_values(ctx, diff, aval, bval);
+        JS_FreeAtom(ctx, pointer_pop(&diff->ptr));
+      }
+      JS_FreeValue(ctx, aval);
+      JS_FreeValue(ctx, bval);
+
+      if(r < 0)
+        goto end;
+
+      i++;
+      j++;
+    }
+  }
+
+  if(is_array && blen < alen) {
+    JSValue length = JS_NewInt64(ctx, blen);
+    pointer_push(&diff->ptr, ctx, JS_NewAtom(ctx, "length"));
+    js_deep_diff_edit(ctx, diff, DEEP_OP_REPLACE, length);
+    JS_FreeAtom(ctx, pointer_pop(&diff->ptr));
+  }
+
+  ret = 0;
+
+end:
+  js_deep_propenum_free(ctx, atoms_a, natoms_a);
+  js_deep_propenum_free(ctx, atoms_b, natoms_b);
+  vector_pop(&diff->pairs, sizeof(JSObject*));
+  vector_pop(&diff->pairs, sizeof(JSObject*));
+  return ret;
+}
+
+static int
+js_deep_diff_values(JSContext* ctx, DeepDiff* diff, JSValueConst a, JSValueConst b) {
+  int r;
+
+  if(JS_IsObject(a) && JS_IsObject(b) && JS_VALUE_GET_OBJ(a)->class_id == JS_VALUE_GET_OBJ(b)->class_id &&
+     !JS_IsFunction(ctx, a)) {
+    Vector pairs = VECTOR(ctx);
+
+    /* a Date, boxed primitive, Map or Set with different internal state is replaced as a whole */
+    r = js_deep_equal_internal(ctx, JS_VALUE_GET_OBJ(a), JS_VALUE_GET_OBJ(b), &pairs);
+    vector_free(&pairs);
+
+    if(r > 0)
+      return js_deep_diff_objects(ctx, diff, a, b);
+  } else {
+    r = js_deep_equal_values(ctx, a, b, &diff->pairs);
+  }
+
+  if(r < 0)
+    return -1;
+
+  if(r == 0)
+    js_deep_diff_edit(ctx, diff, DEEP_OP_REPLACE, b);
+
+  return 0;
+}
+
+static JSValue
+js_deep_diff(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv) {
+  DeepDiff diff = {{0, 0}, VECTOR(ctx), JS_NewArray(ctx), 0, 0};
+
+  if(argc > 2)
+    diff.flags = js_deep_parseflags(ctx, argc - 2, argv + 2);
+
+  if(js_deep_diff_values(ctx, &diff, argv[0], argv[1]) < 0) {
+    JS_FreeValue(ctx, diff.edits);
+    diff.edits = JS_EXCEPTION;
+  }
+
+  pointer_reset(&diff.ptr, ctx);
+  vector_free(&diff.pairs);
+  return diff.edits;
+}
+
+/* applies the edits to argv[0] in place and returns it, clone() it first to keep the original */
+static JSValue
+js_deep_patch(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv) {
+  JSValue ret;
+  int64_t i, len;
+
+  if(!JS_IsArray(ctx, argv[1]))
+    return JS_ThrowTypeError(ctx, "argument 2 (edits) is not an array");
+
+  ret = JS_DupValue(ctx, argv[0]);
+  len = js_array_length(ctx, argv[1]);
+
+  for(i = 0; i < len; i++) {
+    JSValue edit, path, value, obj;
+    Pointer ptr = {0, 0};
+    const char* opstr;
+    int op = -1, r;
+
+    edit = JS_GetPropertyUint32(ctx, argv[1], i);
+    path = JS_GetPropertyUint32(ctx, edit, 0);
+    value = JS_GetPropertyUint32(ctx, edit, 2);
+
+    if((opstr = js_get_propertyint_cstring(ctx, edit, 1))) {
+      for(op = 0; js_deep_ops[op]; op++)
+        if(!strcmp(opstr, js_deep_ops[op]))
+          break;
+      js_free(ctx, (char*)opstr);
+    }
+    JS_FreeValue(ctx, edit);
+
+    if(op < 0 || !js_deep_ops[op]) {
+      JS_FreeValue(ctx, path);
+      JS_FreeValue(ctx, value);
+      JS_FreeValue(ctx, ret);
+      return JS_ThrowTypeError(ctx, "edit #%" PRId64 " has no valid op", i);
+    }
+
+    if(!JS_IsString(path) && !JS_IsArray(ctx, path)) {
+      JS_FreeValue(ctx, path);
+      JS_FreeValue(ctx, value);
+      JS_FreeValue(ctx, ret);
+      return JS_ThrowTypeError(ctx, "edit #%" PRId64 " has a path which is neither a string nor an array", i);
+    }
+
+    if(!(JS_IsArray(ctx, path) && js_array_length(ctx, path) == 0))
+      pointer_from(&ptr, ctx, path, 0);
+    JS_FreeValue(ctx, path);
+
+    if(ptr.n == 0) {
+      JS_FreeValue(ctx, ret);
+      ret = op == DEEP_OP_REMOVE ? JS_UNDEFINED : JS_DupValue(ctx, value);
+    } else {
+      JSAtom prop = pointer_pop(&ptr);
+      obj = pointer_acquire(&ptr, ctx, ret);
+
+      if(JS_IsException(obj)) {
+        JS_FreeAtom(ctx, prop);
+        pointer_reset(&ptr, ctx);
+        JS_FreeValue(ctx, value);
+        JS_FreeValue(ctx, ret);
+        return JS_EXCEPTION;
+      }
+
+      if(op == DEEP_OP_REMOVE)
+        r = JS_DeleteProperty(ctx, obj, prop, 0);
+      else
+        r = JS_SetProperty(ctx, obj, prop, JS_DupValue(ctx, value));
+
+      JS_FreeAtom(ctx, prop);
+      JS_FreeValue(ctx, obj);
+
+      if(r < 0) {
+        pointer_reset(&ptr, ctx);
+        JS_FreeValue(ctx, value);
+        JS_FreeValue(ctx, ret);
+        return JS_EXCEPTION;
+      }
+    }
+
+    pointer_reset(&ptr, ctx);
+    JS_FreeValue(ctx, value);
+  }
+
   return ret;
 }
 
@@ -615,10 +1627,412 @@ js_deep_iterate(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* a
   return js_deep_iterator_constructor(ctx, deep_iterator_ctor, argc, argv);
 }
 
+typedef struct DeepCloneRef {
+  JSObject* obj;
+  JSValue clone;
+} DeepCloneRef;
+
+typedef struct DeepClone {
+  DeepCloneRef* refs;
+  uint32_t nrefs, size; /* open addressing, size is a power of 2 */
+  Vector transfer;
+  uint32_t max_depth;
+} DeepClone;
+
+static inline uint32_t
+js_deep_clone_slot(DeepClone* dc, JSObject* obj) {
+  uint32_t i = (uint32_t)(((uintptr_t)obj >> 4) * 0x9e3779b1u) & (dc->size - 1);
+
+  while(dc->refs[i].obj && dc->refs[i].obj != obj) i = (i + 1) & (dc->size - 1);
+  return i;
+}
+
+static JSValue*
+js_deep_clone_find(DeepClone* dc, JSObject* obj) {
+  DeepCloneRef* ref;
+
+  if(dc->size == 0)
+    return 0;
+
+  ref = &dc->refs[js_deep_clone_slot(dc, obj)];
+  return ref->obj ? &ref->clone : 0;
+}
+
+static int
+js_deep_clone_insert(JSContext* ctx, DeepClone* dc, JSObject* obj, JSValueConst clone) {
+  DeepCloneRef* ref;
+
+  if((dc->nrefs + 1) * 2 > dc->size) {
+    DeepCloneRef* old = dc->refs;
+    uint32_t i, old_size = dc->size;
+
+    dc->size = old_size ? old_size * 2 : 64;
+
+    if(!(dc->refs = js_mallocz(ctx, sizeof(DeepCloneRef) * dc->size))) {
+      dc->refs = old;
+      dc->size = old_size;
+      return -1;
+    }
+
+    for(i = 0; i < old_size; i++)
+      if(old[i].obj)
+        dc->refs[js_deep_clone_slot(dc, old[i].obj)] = old[i];
+
+    js_free(ctx, old);
+  }
+
+  ref = &dc->refs[js_deep_clone_slot(dc, obj)];
+  ref->obj = obj;
+  ref->clone = JS_DupValue(ctx, clone);
+  dc->nrefs++;
+  return 0;
+}
+
+static void
+js_deep_clone_free(JSContext* ctx, DeepClone* dc) {
+  JSObject** ptr;
+  uint32_t i;
+
+  for(i = 0; i < dc->size; i++)
+    if(dc->refs[i].obj)
+      JS_FreeValue(ctx, dc->refs[i].clone);
+
+  js_free(ctx, dc->refs);
+
+  vector_foreach_t(&dc->transfer, ptr) JS_FreeValue(ctx, JS_MKPTR(JS_TAG_OBJECT, *ptr));
+  vector_free(&dc->transfer);
+}
+
+static JSValue js_deep_clone_value(JSContext*, DeepClone*, JSValueConst, uint32_t);
+
+static JSValue
+js_deep_clone_construct(JSContext* ctx, JSObject* p, int argc, JSValueConst argv[]) {
+  JSValue global, ctor, ret;
+
+  global = JS_GetGlobalObject(ctx);
+  ctor = JS_GetProperty(ctx, global, JS_GetRuntime(ctx)->class_array[p->class_id].class_name);
+  ret = JS_CallConstructor(ctx, ctor, argc, argv);
+
+  JS_FreeValue(ctx, ctor);
+  JS_FreeValue(ctx, global);
+  return ret;
+}
+
+static JSValue
+js_deep_clone_arraybuffer(JSContext* ctx, DeepClone* dc, JSObject* p) {
+  JSArrayBuffer* abuf = p->u.array_buffer;
+  JSObject** ptr;
+
+  vector_foreach_t(&dc->transfer, ptr) {
+    if(*ptr == p && !abuf->detached) {
+      struct list_head* el;
+      JSValue ret;
+
+      /* hand the data over to the new buffer and detach the old one without freeing it */
+      ret = JS_NewArrayBuffer(ctx, abuf->data, abuf->byte_length, abuf->free_func, abuf->opaque, FALSE);
+      if(JS_IsException(ret))
+        return ret;
+
+      list_for_each(el, &abuf->array_list) {
+        JSObject* obj = list_entry(el, JSTypedArray, link)->obj;
+
+        if(obj->class_id != JS_CLASS_DATAVIEW) {
+          obj->u.array.count = 0;
+          obj->u.array.u.ptr = NULL;
+        }
+      }
+
+      abuf->data = NULL;
+      abuf->byte_length = 0;
+      abuf->detached = TRUE;
+      return ret;
+    }
+  }
+
+  return JS_NewArrayBufferCopy(ctx, abuf->data, abuf->byte_length);
+}
+
+/* log2 of the element size, p->u.array.count is zeroed when the buffer gets detached */
+static int
+js_deep_typedarray_shift(JSClassID class_id) {
+  switch(class_id) {
+    case JS_CLASS_INT16_ARRAY:
+    case JS_CLASS_UINT16_ARRAY: return 1;
+    case JS_CLASS_INT32_ARRAY:
+    case JS_CLASS_UINT32_ARRAY:
+    case JS_CLASS_FLOAT32_ARRAY: return 2;
+#ifdef CONFIG_BIGNUM
+    case JS_CLASS_BIG_INT64_ARRAY:
+    case JS_CLASS_BIG_UINT64_ARRAY:
+#endif
+    case JS_CLASS_FLOAT64_ARRAY: return 3;
+    default: return 0;
+  }
+}
+
+static JSValue
+js_deep_clone_typedarray(JSContext* ctx, DeepClone* dc, JSObject* p, uint32_t depth) {
+  JSTypedArray* ta = p->u.typed_array;
+  uint32_t offset = ta->offset, length = ta->length;
+  JSValue args[3], ret;
+
+  /* ta->length is in bytes and survives a transfer of the buffer */
+  if(p->class_id != JS_CLASS_DATAVIEW)
+    length >>= js_deep_typedarray_shift(p->class_id);
+
+  args[0] = js_deep_clone_value(ctx, dc, JS_MKPTR(JS_TAG_OBJECT, ta->buffer), depth);
+  if(JS_IsException(args[0]))
+    return args[0];
+
+  args[1] = JS_NewUint32(ctx, offset);
+  args[2] = JS_NewUint32(ctx, length);
+
+  ret = js_deep_clone_construct(ctx, p, 3, args);
+  JS_FreeValue(ctx, args[0]);
+  return ret;
+}
+
+static int
+js_deep_clone_map(JSContext* ctx, DeepClone* dc, JSObject* p, JSValueConst dst, uint32_t depth) {
+  BOOL is_set = p->class_id == JS_CLASS_SET;
+  Vector entries = VECTOR(ctx);
+  JSValue* entry;
+  JSAtom method;
+  int ret = 0;
+
+  js_deep_map_entries(ctx, p, &entries);
+
+  method = JS_NewAtom(ctx, is_set ? "add" : "set");
+
+  for(entry = vector_begin(&entries); entry != vector_end(&entries); entry += 2) {
+    if(ret == 0) {
+      JSValue args[2], result;
+
+      args[0] = js_deep_clone_value(ctx, dc, entry[0], depth);
+      args[1] = is_set ? JS_UNDEFINED : js_deep_clone_value(ctx, dc, entry[1], depth);
+
+      if(JS_IsException(args[0]) || JS_IsException(args[1]))
+        ret = -1;
+      else if(JS_IsException((result = JS_Invoke(ctx, dst, method, is_set ? 1 : 2, args))))
+        ret = -1;
+      else
+        JS_FreeValue(ctx, result);
+
+      JS_FreeValue(ctx, args[0]);
+      JS_FreeValue(ctx, args[1]);
+    }
+
+    JS_FreeValue(ctx, entry[0]);
+    JS_FreeValue(ctx, entry[1]);
+  }
+
+  JS_FreeAtom(ctx, method);
+  vector_free(&entries);
+  return ret;
+}
+
+static int
+js_deep_clone_properties(JSContext* ctx, DeepClone* dc, JSValueConst src, JSValueConst dst, uint32_t depth) {
+  JSObject* p = JS_VALUE_GET_OBJ(src);
+  JSPropertyEnum* tab;
+  uint32_t i, len;
+  BOOL is_fast = p->class_id == JS_CLASS_ARRAY && p->fast_array;
+  /* message and stack of errors aren't enumerable */
+  int flags = p->class_id == JS_CLASS_ERROR ? JS_GPN_STRING_MASK | JS_GPN_SYMBOL_MASK : PROPENUM_DEFAULT_FLAGS;
+  int ret = 0;
+
+  /* elements of fast arrays are copied directly, the other own properties below */
+  if(is_fast) {
+    for(i = 0; p->fast_array && i < p->u.array.count; i++) {
+      JSValue value = JS_DupValue(ctx, p->u.array.u.values[i]);
+      JSValue clone = js_deep_clone_value(ctx, dc, value, depth);
+
+      JS_FreeValue(ctx, value);
+      if(JS_IsException(clone))
+        return -1;
+
+      if(JS_SetPropertyUint32(ctx, dst, i, clone) < 0)
+        return -1;
+    }
+  }
+
+  if(JS_GetOwnPropertyNames(ctx, &tab, &len, src, flags))
+    return -1;
+
+  for(i = 0; i < len; i++) {
+    JSValue value, clone;
+
+    /* the characters of a String object come with the clone */
+    if((is_fast || p->class_id == JS_CLASS_STRING) && js_atom_isint(tab[i].atom))
+      continue;
+
+    if(JS_IsException((value = JS_GetProperty(ctx, src, tab[i].atom)))) {
+      ret = -1;
+      break;
+    }
+
+    clone = js_deep_clone_value(ctx, dc, value, depth);
+    JS_FreeValue(ctx, value);
+
+    if(JS_IsException(clone) ||
+       JS_DefinePropertyValue(ctx, dst, tab[i].atom, clone, tab[i].is_enumerable ? JS_PROP_C_W_E : JS_PROP_CONFIGURABLE | JS_PROP_WRITABLE) < 0) {
+      ret = -1;
+      break;
+    }
+  }
+
+  js_deep_propenum_free(ctx, tab, len);
+
+  /* holes at the end and 'new Array(n)' leave the length longer than the last element */
+  if(ret == 0 && p->class_id == JS_CLASS_ARRAY) {
+    int64_t length;
+
+    if((length = js_array_length(ctx, src)) < 0 || JS_SetPropertyStr(ctx, dst, "length", JS_NewInt64(ctx, length)) < 0)
+      ret = -1;
+  }
+
+  return ret;
+}
+
+static JSValue
+js_deep_clone_unsupported(JSContext* ctx, JSObject* p) {
+  const char* name = JS_AtomToCString(ctx, JS_GetRuntime(ctx)->class_array[p->class_id].class_name);
+  JSValue ret = JS_ThrowTypeError(ctx, "DataCloneError: %s objects can't be cloned", name ? name : "these");
+
+  if(name)
+    JS_FreeCString(ctx, name);
+  return ret;
+}
+
+static JSValue
+js_deep_clone_value(JSContext* ctx, DeepClone* dc, JSValueConst value, uint32_t depth) {
+  JSObject* p;
+  JSValue ret, proto, *ref;
+  BOOL is_map = FALSE, is_object = FALSE;
+  int result = 0;
+
+  if(!JS_IsObject(value))
+    return JS_DupValue(ctx, value);
+
+  p = JS_VALUE_GET_OBJ(value);
+
+  if((ref = js_deep_clone_find(dc, p)))
+    return JS_DupValue(ctx, *ref);
+
+  if(depth >= dc->max_depth || JS_IsFunction(ctx, value) || p->class_id == JS_CLASS_SHARED_ARRAY_BUFFER)
+    return JS_DupValue(ctx, value);
+
+  switch(p->class_id) {
+    case JS_CLASS_UINT8C_ARRAY ... JS_CLASS_DATAVIEW: ret = js_deep_clone_typedarray(ctx, dc, p, depth + 1); break;
+    case JS_CLASS_ARRAY_BUFFER: ret = js_deep_clone_arraybuffer(ctx, dc, p); break;
+
+    /* these take the original as the argument of their constructor */
+    case JS_CLASS_DATE:
+    case JS_CLASS_REGEXP:
+    case JS_CLASS_NUMBER:
+    case JS_CLASS_STRING:
+    case JS_CLASS_BOOLEAN: ret = js_deep_clone_construct(ctx, p, 1, &value); break;
+
+    case JS_CLASS_MAP:
+    case JS_CLASS_SET: ret = js_deep_clone_construct(ctx, p, 0, 0); break;
+
+    case JS_CLASS_ERROR: ret = JS_NewError(ctx); break;
+    case JS_CLASS_ARRAY: ret = JS_NewArray(ctx); break;
+    case JS_CLASS_OBJECT:
+    case JS_CLASS_ARGUMENTS: ret = JS_NewObject(ctx); break;
+    default: return js_deep_clone_unsupported(ctx, p);
+  }
+
+  if(JS_IsException(ret))
+    return ret;
+
+  /* class instances keep their prototype */
+  if(JS_IsException((proto = JS_GetPrototype(ctx, value))) || JS_SetPrototype(ctx, ret, proto) < 0) {
+    JS_FreeValue(ctx, proto);
+    JS_FreeValue(ctx, ret);
+    return JS_EXCEPTION;
+  }
+  JS_FreeValue(ctx, proto);
+
+  /* register before descending, so cycles and shared objects resolve to the clone */
+  if(js_deep_clone_insert(ctx, dc, p, ret)) {
+    JS_FreeValue(ctx, ret);
+    return JS_ThrowOutOfMemory(ctx);
+  }
+
+  is_map = p->class_id == JS_CLASS_MAP || p->class_id == JS_CLASS_SET;
+  /* buffers and views have no own properties besides their elements */
+  is_object = !(p->class_id >= JS_CLASS_ARRAY_BUFFER && p->class_id <= JS_CLASS_DATAVIEW);
+
+  if(is_map)
+    result = js_deep_clone_map(ctx, dc, p, ret, depth + 1);
+  if(result == 0 && is_object)
+    result = js_deep_clone_properties(ctx, dc, value, ret, depth + 1);
+
+  if(result) {
+    JS_FreeValue(ctx, ret);
+    return JS_EXCEPTION;
+  }
+
+  return ret;
+}
+
 static JSValue
 js_deep_clone(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv) {
+  DeepClone dc = {0, 0, 0, VECTOR(ctx), UINT32_MAX};
+  JSValue ret, max_depth = JS_UNDEFINED;
+  JSObject** ptr;
+
+  if(argc > 1 && JS_IsNumber(argv[1])) {
+    max_depth = JS_DupValue(ctx, argv[1]);
+  } else if(argc > 1 && JS_IsObject(argv[1])) {
+    JSValue transfer;
+
+    max_depth = JS_GetPropertyStr(ctx, argv[1], "maxDepth");
+
+    transfer = JS_GetPropertyStr(ctx, argv[1], "transfer");
+    if(JS_IsArray(ctx, transfer)) {
+      int64_t i, len = js_array_length(ctx, transfer);
+
+      for(i = 0; i < len; i++) {
+        JSValue item = JS_GetPropertyUint32(ctx, transfer, i);
+
+        /* the reference is kept until the buffers are detached */
+        if(JS_IsObject(item) && JS_VALUE_GET_OBJ(item)->class_id == JS_CLASS_ARRAY_BUFFER) {
+          JSObject* obj = JS_VALUE_GET_OBJ(JS_DupValue(ctx, item));
+          vector_push(&dc.transfer, obj);
+        }
+        JS_FreeValue(ctx, item);
+      }
+    }
+    JS_FreeValue(ctx, transfer);
+  }
+
+  /* maxDepth counts the levels that are copied, Infinity or no maxDepth copy everything */
+  if(JS_IsNumber(max_depth)) {
+    double d;
+
+    JS_ToFloat64(ctx, &d, max_depth);
 
-  return js_value_clone(ctx, argv[0]);
+    if(!(d >= 1)) {
+      JS_FreeValue(ctx, max_depth);
+      js_deep_clone_free(ctx, &dc);
+      return JS_ThrowRangeError(ctx, "maxDepth must be at least 1");
+    }
+
+    dc.max_depth = d < UINT32_MAX ? (uint32_t)d : UINT32_MAX;
+  }
+  JS_FreeValue(ctx, max_depth);
+
+  ret = js_deep_clone_value(ctx, &dc, argv[0], 0);
+
+  /* buffers in 'transfer' which aren't reachable from the value are detached as well */
+  if(!JS_IsException(ret))
+    vector_foreach_t(&dc.transfer, ptr) if(!(*ptr)->u.array_buffer->detached)
+        JS_DetachArrayBuffer(ctx, JS_MKPTR(JS_TAG_OBJECT, *ptr));
+
+  js_deep_clone_free(ctx, &dc);
+  return ret;
 }
 
 static JSClassDef js_deep_iterator_class = {
@@ -633,10 +2047,15 @@ static const JSCFunctionListEntry js_deep_funcs[] = {
     JS_CFUNC_DEF("set", 3, js_deep_set),
     JS_CFUNC_DEF("unset", 2, js_deep_unset),
     JS_CFUNC_DEF("flatten", 1, js_deep_flatten),
+    JS_CFUNC_DEF("flattenColumns", 1, js_deep_flatten_columns),
     JS_CFUNC_DEF("pathOf", 2, js_deep_pathof),
     JS_CFUNC_DEF("equals", 2, js_deep_equals),
+    JS_CFUNC_DEF("hash", 1, js_deep_hash),
+    JS_CFUNC_DEF("diff", 2, js_deep_diff),
+    JS_CFUNC_DEF("patch", 2, js_deep_patch),
     JS_CFUNC_DEF("iterate", 1, js_deep_iterate),
     JS_CFUNC_DEF("forEach", 2, js_deep_foreach),
+    JS_CFUNC_DEF("forEachAsync", 2, js_deep_foreach_async),
     JS_CFUNC_DEF("clone", 1, js_deep_clone),
     JS_PROP_INT32_DEF("TYPE_UNDEFINED", TYPE_UNDEFINED, JS_PROP_ENUMERABLE),
     JS_PROP_INT32_DEF("TYPE_NULL", TYPE_NULL, JS_PROP_ENUMERABLE),
@@ -15,6 +15,8 @@
 #include <math.h>
 #include <string.h>
 #include <sys/ioctl.h>
+#include <errno.h>
+#include <unistd.h>
 
 #define INSPECT_INT32T_INRANGE(i) ((i) > INT32_MIN && (i) < INT32_MAX)
 #define INSPECT_LEVEL(opts) ((opts)->depth - (depth))
@@ -23,6 +25,8 @@
        ? TRUE                                                                                                          \
        : INSPECT_INT32T_INRANGE((opts)->compact) ? INSPECT_LEVEL(opts) >= (opts)->compact : 0)
 
+enum inspect_format { INSPECT_FORMAT_TEXT = 0, INSPECT_FORMAT_JSON };
+
 typedef struct {
   int colors : 1;
   int show_hidden : 1;
@@ -38,17 +42,53 @@ typedef struct {
   int32_t proto_chain;
   int32_t number_base;
   Vector hide_keys;
+  JSAtom* hide_set; /* hide_keys as an open addressing table of hide_mask + 1 slots */
+  uint32_t hide_mask;
+  struct inspect_keys* keys; /* printed keys, for the duration of one call */
+  int64_t max_output_bytes;
+  int32_t max_nodes;
+  int32_t nodes;  /* values printed so far */
+  BOOL exhausted; /* maxOutputBytes or maxNodes reached, the traversal stops */
+  int32_t format; /* INSPECT_FORMAT_TEXT or INSPECT_FORMAT_JSON */
+  int32_t fd;      /* inspect.write() target, -1 when rendering to a string */
+  int64_t written; /* bytes written to fd so far, -1 after an error */
+  int error;       /* errno of the failed write() */
 } inspect_options_t;
 
 struct prop_key;
 
 typedef struct prop_key {
   struct list_head link;
-  const char* name;
   JSAtom atom;
 } prop_key_t;
 
+#define INSPECT_KEY_CACHE_SIZE 256
+
+enum {
+  INSPECT_KEY_HIDDEN = 1,  /* in hideKeys */
+  INSPECT_KEY_INTEGER = 2, /* an index, printed with the array elements */
+  INSPECT_KEY_QUOTED = 4,  /* a string in quotes or a symbol, 'text' only applies where it doesn't need breaking */
+  INSPECT_KEY_LONG = 8,    /* would be broken or truncated anywhere, never printed from 'text' */
+};
+
+typedef struct {
+  JSAtom atom;
+  uint32_t flags;
+  uint32_t offset, size;   /* of the printed form in inspect_keys_t.text */
+  uint32_t prefix, length; /* columns before the string, and its length */
+} inspect_key_t;
+
+typedef struct inspect_keys {
+  uint32_t count, used;
+  DynBuf text;
+  inspect_key_t scratch; /* for the keys that come once the table is full */
+  inspect_key_t table[INSPECT_KEY_CACHE_SIZE];
+} inspect_keys_t;
+
+static JSClassID js_inspect_options_class_id;
+
 static int js_inspect_print(JSContext* ctx, DynBuf* buf, JSValueConst value, inspect_options_t* opts, int32_t depth);
+static int js_inspect_string(JSContext* ctx, DynBuf* buf, JSValueConst value, inspect_options_t* opts, int32_t depth);
 
 static int
 regexp_predicate(int c) {
@@ -81,18 +121,65 @@ inspect_options_init(inspect_options_t* opts, JSContext* ctx) {
   opts->proto_chain = 0;
   opts->number_base = 10;
   vector_init(&opts->hide_keys, ctx);
+  opts->hide_set = 0;
+  opts->hide_mask = 0;
+  opts->keys = 0;
+  opts->max_output_bytes = INT64_MAX;
+  opts->max_nodes = INT32_MAX;
+  opts->nodes = 0;
+  opts->exhausted = FALSE;
+  opts->format = INSPECT_FORMAT_TEXT;
+  opts->fd = -1;
+  opts->written = 0;
+  opts->error = 0;
 }
 
 static void
-inspect_options_free(inspect_options_t* opts, JSContext* ctx) {
+inspect_options_free_rt(inspect_options_t* opts, JSRuntime* rt) {
+  prop_key_t* key;
+
+  vector_foreach_t(&opts->hide_keys, key) { JS_FreeAtomRT(rt, key->atom); }
+  vector_free(&opts->hide_keys);
+
+  if(opts->hide_set) {
+    js_free_rt(rt, opts->hide_set);
+    opts->hide_set = 0;
+  }
+}
 
+/* builds the hash set inspect_options_hidden() looks the keys up in */
+static void
+inspect_options_hideset(inspect_options_t* opts, JSContext* ctx) {
+  JSRuntime* rt = JS_GetRuntime(ctx);
   prop_key_t* key;
+  uint32_t i, size = 4;
+
+  if(opts->hide_set) {
+    js_free_rt(rt, opts->hide_set);
+    opts->hide_set = 0;
+  }
+
+  if(vector_empty(&opts->hide_keys))
+    return;
+
+  while(size < vector_size(&opts->hide_keys, sizeof(prop_key_t)) * 2) size <<= 1;
+
+  if(!(opts->hide_set = js_mallocz_rt(rt, size * sizeof(JSAtom))))
+    return;
+
+  opts->hide_mask = size - 1;
 
   vector_foreach_t(&opts->hide_keys, key) {
-    JS_FreeAtom(ctx, key->atom);
-    js_cstring_free(ctx, key->name);
+    for(i = key->atom & opts->hide_mask; opts->hide_set[i] != JS_ATOM_NULL; i = (i + 1) & opts->hide_mask)
+      if(opts->hide_set[i] == key->atom)
+        break;
+    opts->hide_set[i] = key->atom;
   }
-  vector_free(&opts->hide_keys);
+}
+
+static void
+inspect_options_free(inspect_options_t* opts, JSContext* ctx) {
+  inspect_options_free_rt(opts, JS_GetRuntime(ctx));
 }
 
 static void
@@ -178,12 +265,12 @@ inspect_options_get(inspect_options_t* opts, JSContext* ctx, JSValueConst object
     for(pos = 0; pos < len; pos++) {
       JSValue item = JS_GetPropertyUint32(ctx, value, pos);
       prop_key_t key;
-      key.name = JS_ToCString(ctx, item);
       key.atom = JS_ValueToAtom(ctx, item);
       vector_push(&opts->hide_keys, key);
       JS_FreeValue(ctx, item);
     }
     JS_FreeValue(ctx, value);
+    inspect_options_hideset(opts, ctx);
   }
   value = JS_GetPropertyStr(ctx, object, "protoChain");
   if(JS_IsNumber(value))
@@ -194,6 +281,24 @@ inspect_options_get(inspect_options_t* opts, JSContext* ctx, JSValueConst object
   if(JS_IsNumber(value))
     JS_ToInt32(ctx, &opts->number_base, value);
   JS_FreeValue(ctx, value);
+
+  value = JS_GetPropertyStr(ctx, object, "maxOutputBytes");
+  if(JS_IsNumber(value) && !isinf(JS_VALUE_GET_FLOAT64(value)))
+    JS_ToInt64(ctx, &opts->max_output_bytes, value);
+  JS_FreeValue(ctx, value);
+
+  value = JS_GetPropertyStr(ctx, object, "maxNodes");
+  if(JS_IsNumber(value) && !isinf(JS_VALUE_GET_FLOAT64(value)))
+    JS_ToInt32(ctx, &opts->max_nodes, value);
+  JS_FreeValue(ctx, value);
+
+  value = JS_GetPropertyStr(ctx, object, "format");
+  if(JS_IsString(value)) {
+    const char* str = JS_ToCString(ctx, value);
+    opts->format = !strcmp(str, "json") ? INSPECT_FORMAT_JSON : INSPECT_FORMAT_TEXT;
+    js_cstring_free(ctx, str);
+  }
+  JS_FreeValue(ctx, value);
 }
 
 static JSValue
@@ -220,16 +325,229 @@ inspect_options_object(inspect_options_t* opts, JSContext* ctx) {
   vector_foreach_t(&opts->hide_keys, key) { JS_SetPropertyUint32(ctx, arr, n++, js_atom_tovalue(ctx, key->atom)); }
   JS_SetPropertyStr(ctx, ret, "hideKeys", arr);
   JS_SetPropertyStr(ctx, ret, "numberBase", js_new_number(ctx, opts->number_base));
+  if(opts->max_output_bytes != INT64_MAX)
+    JS_SetPropertyStr(ctx, ret, "maxOutputBytes", JS_NewInt64(ctx, opts->max_output_bytes));
+  if(opts->max_nodes != INT32_MAX)
+    JS_SetPropertyStr(ctx, ret, "maxNodes", js_new_number(ctx, opts->max_nodes));
+  if(opts->format == INSPECT_FORMAT_JSON)
+    JS_SetPropertyStr(ctx, ret, "format", JS_NewString(ctx, "json"));
   return ret;
 }
 
 static int
 inspect_options_hidden(inspect_options_t* opts, JSAtom atom) {
-  prop_key_t* key;
-  vector_foreach_t(&opts->hide_keys, key) {
-    if(key->atom == atom) //! strcmp(key->name, str))
+  uint32_t i;
+
+  if(!opts->hide_set)
+    return 0;
+
+  for(i = atom & opts->hide_mask; opts->hide_set[i] != JS_ATOM_NULL; i = (i + 1) & opts->hide_mask)
+    if(opts->hide_set[i] == atom)
       return 1;
+
+  return 0;
+}
+
+static void
+inspect_keys_init(inspect_keys_t* keys, JSRuntime* rt) {
+  keys->count = keys->used = 0;
+  js_dbuf_init_rt(rt, &keys->text);
+  memset(&keys->scratch, 0, sizeof(keys->scratch));
+  memset(keys->table, 0, sizeof(keys->table));
+}
+
+static void
+inspect_keys_free(inspect_keys_t* keys, JSRuntime* rt) {
+  uint32_t i;
+
+  for(i = 0; i < INSPECT_KEY_CACHE_SIZE; i++)
+    if(keys->table[i].atom != JS_ATOM_NULL)
+      JS_FreeAtomRT(rt, keys->table[i].atom);
+
+  dbuf_free(&keys->text);
+}
+
+/* whether js_inspect_string() leaves a string of 'len' bytes, starting 'prefix' columns further right, in one piece */
+static BOOL
+inspect_key_fits(DynBuf* buf, inspect_options_t* opts, size_t prefix, size_t len) {
+  return min_size(opts->break_length - (dbuf_get_column(buf) + prefix) - 12, len) >= len;
+}
+
+/* prints a string or symbol key like js_inspect_print() would, but without counting it against the budget */
+static void
+inspect_key_string(JSContext* ctx, DynBuf* buf, JSValueConst key, inspect_options_t* opts) {
+  if(JS_IsSymbol(key)) {
+    JSValue str = js_symbol_to_string(ctx, key);
+
+    dbuf_putc(buf, '[');
+    if(opts->colors)
+      dbuf_putstr(buf, COLOR_GREEN);
+    dbuf_putstr(buf, "Symbol");
+    js_inspect_string(ctx, buf, str, opts, 0);
+    dbuf_putc(buf, ']');
+    JS_FreeValue(ctx, str);
+  } else {
+    js_inspect_string(ctx, buf, key, opts, 0);
+  }
+}
+
+/* looks up how the property key 'atom' prints, which is the same throughout a call, as the options don't change */
+static inspect_key_t*
+inspect_key_get(JSContext* ctx, inspect_options_t* opts, JSAtom atom) {
+  inspect_keys_t* keys = opts->keys;
+  inspect_key_t* k;
+  JSValue key;
+  const char* name;
+  size_t len;
+  uint32_t i;
+
+  for(i = atom & (INSPECT_KEY_CACHE_SIZE - 1);; i = (i + 1) & (INSPECT_KEY_CACHE_SIZE - 1)) {
+    k = &keys->table[i];
+
+    if(k->atom == atom)
+      return k;
+    if(k->atom == JS_ATOM_NULL)
+      break;
+  }
+
+  /* keep the table at most 3/4 full */
+  if(keys->count >= INSPECT_KEY_CACHE_SIZE * 3 / 4) {
+    k = &keys->scratch;
+    k->atom = atom;
+    keys->text.size = keys->used;
+  } else {
+    k->atom = JS_DupAtom(ctx, atom);
+    keys->count++;
+  }
+
+  k->flags = 0;
+  k->prefix = k->length = 0;
+
+  key = js_atom_tovalue(ctx, atom);
+  name = JS_AtomToCString(ctx, atom);
+
+  if(JS_IsSymbol(key)) {
+    JSValue str = js_symbol_to_string(ctx, key);
+    js_cstring_free(ctx, JS_ToCStringLen(ctx, &len, str));
+    JS_FreeValue(ctx, str);
+
+    k->flags |= INSPECT_KEY_QUOTED;
+    k->prefix = 7; /* [Symbol */
+  } else {
+    len = strlen(name);
+
+    if(inspect_options_hidden(opts, atom))
+      k->flags |= INSPECT_KEY_HIDDEN;
+    if(is_integer(name))
+      k->flags |= INSPECT_KEY_INTEGER;
+    if(!is_identifier(name) && !is_integer(name))
+      k->flags |= INSPECT_KEY_QUOTED;
+  }
+
+  k->length = len;
+
+  /* start on a new line, so the column is where it'd be for the shortest prefix */
+  dbuf_putc(&keys->text, '\n');
+  k->offset = keys->text.size;
+
+  if(!(k->flags & INSPECT_KEY_QUOTED)) {
+    dbuf_putstr(&keys->text, name);
+  } else if(len > (size_t)opts->max_string_length || !inspect_key_fits(&keys->text, opts, k->prefix, len)) {
+    k->flags |= INSPECT_KEY_LONG;
+  } else {
+    inspect_key_string(ctx, &keys->text, key, opts);
+  }
+
+  k->size = keys->text.size - k->offset;
+
+  if(k != &keys->scratch)
+    keys->used = keys->text.size;
+
+  js_cstring_free(ctx, name);
+  JS_FreeValue(ctx, key);
+  return k;
+}
+
+static void
+inspect_key_print(JSContext* ctx, DynBuf* buf, inspect_key_t* k, inspect_options_t* opts, int32_t depth) {
+  JSValue key;
+
+  if(!(k->flags & INSPECT_KEY_LONG) &&
+     (!(k->flags & INSPECT_KEY_QUOTED) || inspect_key_fits(buf, opts, k->prefix, k->length))) {
+    dbuf_put(buf, opts->keys->text.buf + k->offset, k->size);
+    return;
+  }
+
+  key = js_atom_tovalue(ctx, k->atom);
+  inspect_key_string(ctx, buf, key, opts);
+  JS_FreeValue(ctx, key);
+}
+
+/* checks whether 'need' more bytes of output still fit into maxOutputBytes. once they don't, the marker is printed
+ * in place of what was to come, and the loops stop before their next item */
+static BOOL
+inspect_truncated(DynBuf* buf, inspect_options_t* opts, int64_t need) {
+  int64_t size = buf->size + (opts->written > 0 ? opts->written : 0);
+
+  if(!opts->exhausted && need <= opts->max_output_bytes - size)
+    return FALSE;
+
+  opts->exhausted = TRUE;
+
+  if(opts->format == INSPECT_FORMAT_JSON)
+    dbuf_putstr(buf, "{\"$type\":\"truncated\"}");
+  else
+    dbuf_put_colorstr(buf, "[truncated]", COLOR_GRAY, opts->colors);
+
+  return TRUE;
+}
+
+/* counts a value against maxNodes and checks the output so far against maxOutputBytes, like inspect_truncated() */
+static BOOL
+inspect_exhausted(DynBuf* buf, inspect_options_t* opts) {
+  if(!opts->exhausted && ++opts->nodes > opts->max_nodes)
+    opts->exhausted = TRUE;
+
+  return inspect_truncated(buf, opts, 0);
+}
+
+#define INSPECT_FLUSH_SIZE 65536
+
+/* when writing to a file descriptor, passes the complete lines in 'buf' on to it once there are enough of them.
+ * the partial last line stays, dbuf_get_column() needs it */
+static int
+inspect_flush(DynBuf* buf, inspect_options_t* opts, BOOL all) {
+  size_t n, pos = 0;
+
+  if(opts->fd < 0 || opts->written < 0 || (!all && buf->size < INSPECT_FLUSH_SIZE))
+    return 0;
+
+  /* JSON output is a single line and needs no column */
+  if(all || opts->format == INSPECT_FORMAT_JSON)
+    n = buf->size;
+  else if((n = byte_rchr(buf->buf, buf->size, '\n')) < buf->size)
+    n++;
+  else
+    return 0;
+
+  while(pos < n) {
+    ssize_t r = write(opts->fd, buf->buf + pos, n - pos);
+
+    if(r < 0) {
+      if(errno == EINTR)
+        continue;
+      /* nothing more gets out, so stop rendering */
+      opts->error = errno;
+      opts->written = -1;
+      opts->exhausted = TRUE;
+      return -1;
+    }
+    pos += r;
   }
+
+  memmove(buf->buf, buf->buf + n, buf->size - n);
+  buf->size -= n;
+  opts->written += n;
   return 0;
 }
 
@@ -303,88 +621,169 @@ js_inspect_custom_call(JSContext* ctx, JSValueConst obj, inspect_options_t* opts
   return ret;
 }
 
+/* collects the first 'limit' entries of a Map or Set as key/value pairs, straight from its records when it is a
+ * native one. printing them can call into JS, which could modify the collection, so they are copied first.
+ * returns the total number of entries, or -1 when 'obj' can't be iterated */
+static int64_t
+inspect_map_entries(JSContext* ctx, JSValueConst obj, Vector* entries, uint32_t limit) {
+  JSObject* p = JS_VALUE_GET_OBJ(obj);
+  int64_t count = 0;
+
+  if(p->class_id == JS_CLASS_MAP || p->class_id == JS_CLASS_SET) {
+    struct list_head* el;
+
+    list_for_each(el, &p->u.map_state->records) {
+      JSMapRecord* mr = list_entry(el, JSMapRecord, link);
+      JSValue kv[2];
+
+      if(mr->empty)
+        continue;
+      if(count++ == limit)
+        break;
+
+      kv[0] = JS_DupValue(ctx, mr->key);
+      kv[1] = p->class_id == JS_CLASS_MAP ? JS_DupValue(ctx, mr->value) : JS_UNDEFINED;
+      vector_put(entries, kv, sizeof(kv));
+    }
+
+    return p->u.map_state->record_count;
+  } else {
+    BOOL is_map = js_is_map(ctx, obj);
+    Iteration it;
+
+    if(!iteration_method_symbol(&it, ctx, obj, "iterator"))
+      return -1;
+
+    while(!iteration_next(&it, ctx)) {
+      JSValue kv[2], item;
+
+      if(count++ >= limit)
+        continue;
+
+      item = iteration_value(&it, ctx);
+
+      if(is_map) {
+        kv[0] = JS_GetPropertyUint32(ctx, item, 0);
+        kv[1] = JS_GetPropertyUint32(ctx, item, 1);
+        JS_FreeValue(ctx, item);
+      } else {
+        kv[0] = item;
+        kv[1] = JS_UNDEFINED;
+      }
+      vector_put(entries, kv, sizeof(kv));
+    }
+
+    iteration_reset(&it, JS_GetRuntime(ctx));
+  }
+
+  return count;
+}
+
+static void
+inspect_map_entries_free(JSContext* ctx, Vector* entries) {
+  JSValue* entry;
+
+  vector_foreach_t(entries, entry) { JS_FreeValue(ctx, *entry); }
+  vector_free(entries);
+}
+
+/* "... n more items" after the entries of a Map or Set that were printed */
+static void
+inspect_map_more(DynBuf* buf, inspect_options_t* opts, int32_t depth, int compact, uint32_t printed, int64_t count) {
+  if(count <= printed || opts->exhausted)
+    return;
+
+  if(printed) {
+    dbuf_putc(buf, ',');
+    if(!compact && opts->break_length != INT32_MAX)
+      inspect_newline(buf, INSPECT_LEVEL(opts));
+  }
+  dbuf_putstr(buf, compact ? " " : "  ");
+  dbuf_printf(buf, "... %" PRId64 " more item", count - printed);
+  if(count - printed > 1)
+    dbuf_putc(buf, 's');
+}
+
 static int
 js_inspect_map(JSContext* ctx, DynBuf* buf, JSValueConst obj, inspect_options_t* opts, int32_t depth) {
-  BOOL ret, finish = FALSE;
-  size_t i = 0;
   int compact = INSPECT_IS_COMPACT(opts);
-  // printf("js_inspect_map level=%u opts->depth=%" PRId32 " depth=%" PRId32 " compact=%i\n",
-  // INSPECT_LEVEL(opts), opts->depth, depth, compact);
-  JSValue data, key, value;
-  Iteration it;
-  if(!(ret = iteration_method_symbol(&it, ctx, obj, "iterator"))) {
+  Vector entries = VECTOR(ctx);
+  JSValue* entry;
+  int64_t count;
+  uint32_t i = 0;
+
+  if((count = inspect_map_entries(ctx, obj, &entries, opts->max_array_length)) < 0) {
+    vector_free(&entries);
     JS_ThrowTypeError(ctx, "js_inspect_map tag=%d\n", JS_VALUE_GET_TAG(obj));
     return 0;
   }
   dbuf_putstr(buf, "Map {");
   if(!compact && opts->break_length != INT32_MAX)
     inspect_newline(buf, INSPECT_LEVEL(opts));
-  for(i = 0; !(finish = iteration_next(&it, ctx)); i++) {
-    if(!finish) {
-      data = iteration_value(&it, ctx);
-      if(i) {
-        dbuf_putstr(buf, ",");
-        if(!compact && opts->break_length != INT32_MAX)
-          inspect_newline(buf, INSPECT_LEVEL(opts));
-      }
-      dbuf_putstr(buf, compact ? " " : "  ");
-      key = JS_GetPropertyUint32(ctx, data, 0);
-      js_inspect_print(ctx, buf, key, opts, depth - 1);
-      dbuf_putstr(buf, " => ");
-      value = JS_GetPropertyUint32(ctx, data, 1);
-      js_inspect_print(ctx, buf, value, opts, depth - 1);
-      JS_FreeValue(ctx, key);
-      JS_FreeValue(ctx, value);
-      JS_FreeValue(ctx, data);
+  for(entry = vector_begin(&entries); entry != vector_end(&entries); entry += 2, i++) {
+    if(opts->exhausted)
+      break;
+    if(i) {
+      dbuf_putstr(buf, ",");
+      if(!compact && opts->break_length != INT32_MAX)
+        inspect_newline(buf, INSPECT_LEVEL(opts));
+      inspect_flush(buf, opts, FALSE);
     }
+    dbuf_putstr(buf, compact ? " " : "  ");
+    js_inspect_print(ctx, buf, entry[0], opts, depth - 1);
+    dbuf_putstr(buf, " => ");
+    js_inspect_print(ctx, buf, entry[1], opts, depth - 1);
   }
+  inspect_map_more(buf, opts, depth, compact, i, count);
   if(!compact && opts->break_length != INT32_MAX)
     inspect_newline(buf, INSPECT_LEVEL(opts));
   dbuf_putstr(buf, compact ? " }" : "}");
-  iteration_reset(&it, JS_GetRuntime(ctx));
+  inspect_map_entries_free(ctx, &entries);
   return 0;
 }
 
 static int
 js_inspect_set(JSContext* ctx, DynBuf* buf, JSValueConst obj, inspect_options_t* opts, int32_t depth) {
-  BOOL ret, finish = FALSE;
-  size_t i = 0;
   int compact = INSPECT_IS_COMPACT(opts);
-  JSValue value;
-  Iteration it;
+  Vector entries = VECTOR(ctx);
+  JSValue* entry;
+  int64_t count;
+  uint32_t i = 0;
 
-  if(!(ret = iteration_method_symbol(&it, ctx, obj, "iterator"))) {
+  if((count = inspect_map_entries(ctx, obj, &entries, opts->max_array_length)) < 0) {
+    vector_free(&entries);
     JS_ThrowTypeError(ctx, "js_inspect_map tag=%d\n", JS_VALUE_GET_TAG(obj));
     return 0;
   }
   dbuf_putstr(buf, "Set [");
   if(!compact && opts->break_length != INT32_MAX)
     inspect_newline(buf, INSPECT_LEVEL(opts));
-  for(i = 0; !(finish = iteration_next(&it, ctx)); i++) {
-    if(!finish) {
-      value = iteration_value(&it, ctx);
-      if(i) {
-        dbuf_putstr(buf, ",");
-        if(!compact && opts->break_length != INT32_MAX)
-          inspect_newline(buf, INSPECT_LEVEL(opts));
-      }
-      dbuf_putstr(buf, compact ? " " : "  ");
-      js_inspect_print(ctx, buf, value, opts, depth);
-      JS_FreeValue(ctx, value);
+  for(entry = vector_begin(&entries); entry != vector_end(&entries); entry += 2, i++) {
+    if(opts->exhausted)
+      break;
+    if(i) {
+      dbuf_putstr(buf, ",");
+      if(!compact && opts->break_length != INT32_MAX)
+        inspect_newline(buf, INSPECT_LEVEL(opts));
+      inspect_flush(buf, opts, FALSE);
     }
+    dbuf_putstr(buf, compact ? " " : "  ");
+    js_inspect_print(ctx, buf, entry[0], opts, depth);
   }
+  inspect_map_more(buf, opts, depth, compact, i, count);
   if(!compact && opts->break_length != INT32_MAX)
     inspect_newline(buf, INSPECT_LEVEL(opts));
   dbuf_putstr(buf, compact ? " ]" : "]");
-  iteration_reset(&it, JS_GetRuntime(ctx));
+  inspect_map_entries_free(ctx, &entries);
   return 0;
 }
 
 static int
 js_inspect_arraybuffer(JSContext* ctx, DynBuf* buf, JSValueConst value, inspect_options_t* opts, int32_t depth) {
+  static const char hexdigits[] = "0123456789abcdef";
   const char *str, *str2;
   uint8_t* ptr;
-  size_t i, slen, size;
+  size_t i, j, n, slen, size, limit;
   int break_len = inspect_screen_width();
   int column = dbuf_get_column(buf);
   JSValue proto;
@@ -411,18 +810,37 @@ js_inspect_arraybuffer(JSContext* ctx, DynBuf* buf, JSValueConst value, inspect_
     js_cstring_free(ctx, str);
 
   dbuf_printf(buf, " { byteLength: %zu [", size);
-  for(i = 0; i < size; i++) {
-    if(i == (size_t)opts->max_array_length)
+  limit = min_size(size, opts->max_array_length);
+
+  /* emit whole lines of hex bytes at once, the output budget is checked before each */
+  for(i = 0; i < limit; i += n) {
+    uint8_t* out;
+
+    if(inspect_truncated(buf, opts, 0))
       break;
-    if(column == break_len && opts->break_length != INT32_MAX) {
-      inspect_newline(buf, (opts->depth - depth) + 1);
-      column = 0;
-    } else {
-      column += 3;
+
+    n = limit - i;
+
+    if(opts->break_length != INT32_MAX) {
+      if(column + 3 > break_len && i > 0) {
+        inspect_newline(buf, (opts->depth - depth) + 1);
+        column = ((opts->depth - depth) + 1) * 2;
+      }
+      n = min_size(n, max_num((break_len - column) / 3, 1));
+    }
+
+    if(dbuf_realloc(buf, buf->size + n * 3))
+      return -1;
+
+    for(j = 0, out = buf->buf + buf->size; j < n; j++) {
+      *out++ = ' ';
+      *out++ = hexdigits[ptr[i + j] >> 4];
+      *out++ = hexdigits[ptr[i + j] & 0xf];
     }
-    dbuf_printf(buf, " %02x", ptr[i]);
+    buf->size += n * 3;
+    column += n * 3;
   }
-  if(i < size)
+  if(i < size && !opts->exhausted)
     dbuf_printf(buf, "... %zu more bytes", size - i);
   dbuf_putstr(buf, " ] }");
   return 0;
@@ -476,6 +894,40 @@ js_inspect_number(JSContext* ctx, DynBuf* buf, JSValueConst value, inspect_optio
   return 0;
 }
 
+/* prints element 'i' of a typed array from its backing store, integers without a conversion through JS */
+static int
+js_inspect_typedarray_element(JSContext* ctx, DynBuf* buf, JSObject* p, uint32_t i, inspect_options_t* opts) {
+  int64_t num;
+  JSValue element;
+
+  if(opts->number_base && opts->number_base != 10)
+    goto number;
+
+  switch(p->class_id) {
+    case JS_CLASS_INT8_ARRAY: num = p->u.array.u.int8_ptr[i]; break;
+    case JS_CLASS_UINT8C_ARRAY:
+    case JS_CLASS_UINT8_ARRAY: num = p->u.array.u.uint8_ptr[i]; break;
+    case JS_CLASS_INT16_ARRAY: num = p->u.array.u.int16_ptr[i]; break;
+    case JS_CLASS_UINT16_ARRAY: num = p->u.array.u.uint16_ptr[i]; break;
+    case JS_CLASS_INT32_ARRAY: num = p->u.array.u.int32_ptr[i]; break;
+    case JS_CLASS_UINT32_ARRAY: num = p->u.array.u.uint32_ptr[i]; break;
+    default: goto number;
+  }
+
+  if(opts->colors)
+    dbuf_putstr(buf, COLOR_YELLOW);
+  dbuf_printf(buf, "%" PRId64, num);
+  if(opts->colors)
+    dbuf_putstr(buf, COLOR_NONE);
+  return 0;
+
+number:
+  element = js_typedarray_get(ctx, p, i);
+  js_inspect_number(ctx, buf, element, opts, 0);
+  JS_FreeValue(ctx, element);
+  return 0;
+}
+
 static int
 js_inspect_string(JSContext* ctx, DynBuf* buf, JSValueConst value, inspect_options_t* opts, int32_t depth) {
   int tag = JS_VALUE_GET_TAG(value);
@@ -531,11 +983,63 @@ js_inspect_string(JSContext* ctx, DynBuf* buf, JSValueConst value, inspect_optio
   return 0;
 }
 
+/* levels inspect_fits() descends at most, whatever the compact option says */
+#define INSPECT_FITS_MAX_LEVELS 64
+
+/* whether 'value' goes on a single line: nested at most 'limit' levels and roughly no wider than '*width' columns.
+ * gives up as soon as either is exceeded, so this stays cheap when called for every object printed */
+static BOOL
+inspect_fits(JSRuntime* rt, JSValueConst value, int32_t limit, int64_t* width, BOOL show_hidden) {
+  JSObject* p;
+  JSShapeProperty* prs;
+  int32_t i;
+
+  switch(JS_VALUE_GET_TAG(value)) {
+    case JS_TAG_OBJECT: break;
+    case JS_TAG_STRING: return (*width -= JS_VALUE_GET_STRING(value)->len + 2) >= 0;
+    default: return (*width -= 6) >= 0;
+  }
+
+  if(limit <= 0)
+    return FALSE;
+
+  p = JS_VALUE_GET_OBJ(value);
+  *width -= 4; /* braces */
+
+  if(p->class_id >= JS_CLASS_UINT8C_ARRAY && p->class_id <= JS_CLASS_FLOAT64_ARRAY)
+    *width -= (int64_t)p->u.array.count * 3;
+
+  if(p->fast_array && (p->class_id == JS_CLASS_ARRAY || p->class_id == JS_CLASS_ARGUMENTS)) {
+    for(i = 0; i < (int32_t)p->u.array.count && *width >= 0; i++) {
+      if(!inspect_fits(rt, p->u.array.u.values[i], limit - 1, width, show_hidden))
+        return FALSE;
+      *width -= 2;
+    }
+  }
+
+  for(i = 0, prs = p->shape->prop; i < p->shape->prop_count && *width >= 0; i++, prs++) {
+    if(prs->atom == JS_ATOM_NULL || (prs->flags & JS_PROP_TMASK) != JS_PROP_NORMAL)
+      continue;
+    if(!show_hidden && !(prs->flags & JS_PROP_ENUMERABLE))
+      continue;
+
+    *width -= (js_atom_isint(prs->atom) ? 10 : rt->atom_array[prs->atom]->len) + 4;
+
+    if(!inspect_fits(rt, p->prop[i].u.value, limit - 1, width, show_hidden))
+      return FALSE;
+  }
+
+  return *width >= 0;
+}
+
 static int
 js_inspect_print(JSContext* ctx, DynBuf* buf, JSValueConst value, inspect_options_t* opts, int32_t depth) {
   int tag = JS_VALUE_GET_TAG(value);
   // int compact = INSPECT_IS_COMPACT(opts);
   // printf("js_inspect_print level: %d\n", INSPECT_LEVEL(opts));
+  if(inspect_exhausted(buf, opts))
+    return 0;
+
   switch(tag) {
     case JS_TAG_FLOAT64:
     case JS_TAG_BIG_DECIMAL:
@@ -616,13 +1120,11 @@ js_inspect_print(JSContext* ctx, DynBuf* buf, JSValueConst value, inspect_option
         }
       }
 
+      /* the innermost 'compact' levels go on a single line, as long as it stays within breakLength */
       if(INSPECT_INT32T_INRANGE(opts->compact) && opts->compact > 0) {
-        int32_t deepest = property_enumeration_deepest(ctx, value);
-        const char* typestr = js_value_typestr(ctx, value);
-        // printf("%s opts->compact = %d, deepest = %d, depth = %d\n", typestr ? typestr : "(null)", opts->compact,
-        // deepest, depth);
+        int64_t width = opts->break_length == INT32_MAX ? INT64_MAX : opts->break_length - (int64_t)dbuf_get_column(buf);
 
-        compact = compact >= depth;
+        compact = inspect_fits(JS_GetRuntime(ctx), value, compact < INSPECT_FITS_MAX_LEVELS ? compact : INSPECT_FITS_MAX_LEVELS, &width, opts->show_hidden);
       }
 
       if(!(is_function = JS_IsFunction(ctx, value))) {
@@ -675,8 +1177,10 @@ js_inspect_print(JSContext* ctx, DynBuf* buf, JSValueConst value, inspect_option
                                     &propenum_tab,
                                     opts->proto_chain ? JS_GetPrototype(ctx, value) : value,
                                     JS_GPN_STRING_MASK | JS_GPN_SYMBOL_MASK |
-                                        (opts->show_hidden ? 0 : JS_GPN_ENUM_ONLY)))
+                                        (opts->show_hidden ? 0 : JS_GPN_ENUM_ONLY))) {
+        vector_free(&propenum_tab);
         return -1;
+      }
 
       if(is_function) {
         JSValue name;
@@ -705,6 +1209,10 @@ js_inspect_print(JSContext* ctx, DynBuf* buf, JSValueConst value, inspect_option
       js_object_tmpmark_set(value);
 
       if(is_array || is_typedarray) {
+        JSObject* p = JS_VALUE_GET_OBJ(value);
+        BOOL is_fast = p->fast_array && p->class_id == JS_CLASS_ARRAY;
+
+        is_typedarray = p->class_id >= JS_CLASS_UINT8C_ARRAY && p->class_id <= JS_CLASS_FLOAT64_ARRAY;
         len = js_array_length(ctx, value);
         dbuf_putstr(buf, compact && opts->break_length != INT32_MAX ? "[ " : "[");
         limit = min_size(opts->max_array_length, len);
@@ -713,14 +1221,33 @@ js_inspect_print(JSContext* ctx, DynBuf* buf, JSValueConst value, inspect_option
         for(pos = 0; pos < len; pos++) {
           JSPropertyDescriptor desc;
           JSAtom prop;
-          if(pos == limit)
+          if(pos == limit || opts->exhausted)
             break;
           if(pos > 0) {
             dbuf_putc(buf, ',');
             //            dbuf_putstr(buf, compact ? ", " : ",");
             if(!compact && opts->break_length != INT32_MAX)
               inspect_newline(buf, INSPECT_LEVEL(opts) + 1);
+            inspect_flush(buf, opts, FALSE);
+          }
+
+          /* elements of fast arrays and typed arrays are read directly, the count is checked every time as
+             printing may call into JS */
+          if(is_typedarray && pos < p->u.array.count) {
+            dbuf_putc(buf, ' ');
+            if(!inspect_exhausted(buf, opts))
+              js_inspect_typedarray_element(ctx, buf, p, pos, opts);
+            continue;
           }
+
+          if(is_fast && p->fast_array && pos < p->u.array.count) {
+            JSValue element = JS_DupValue(ctx, p->u.array.u.values[pos]);
+            dbuf_putc(buf, ' ');
+            js_inspect_print(ctx, buf, element, opts, depth - 1);
+            JS_FreeValue(ctx, element);
+            continue;
+          }
+
           prop = JS_NewAtomUInt32(ctx, pos);
           memset(&desc, 0, sizeof(desc));
           desc.value = JS_UNDEFINED;
@@ -754,33 +1281,28 @@ js_inspect_print(JSContext* ctx, DynBuf* buf, JSValueConst value, inspect_option
 
       for(pos = 0; pos < vector_size(&propenum_tab, sizeof(JSPropertyEnum)); pos++) {
         JSPropertyDescriptor desc;
-        const char* name;
         JSPropertyEnum* propenum = (JSPropertyEnum*)vector_at(&propenum_tab, sizeof(JSPropertyEnum), pos);
-        JSValue key = js_atom_tovalue(ctx, propenum->atom);
-        name = JS_AtomToCString(ctx, propenum->atom);
-        if(!JS_IsSymbol(key)) {
-          if(((is_array || is_typedarray) && is_integer(name)) || inspect_options_hidden(opts, propenum->atom)) {
-            JS_FreeValue(ctx, key);
-            js_cstring_free(ctx, name);
-            continue;
-          }
-        }
+        inspect_key_t* k;
+
+        /* the elements have been printed already */
+        if((is_array || is_typedarray) && js_atom_isint(propenum->atom))
+          continue;
+
+        k = inspect_key_get(ctx, opts, propenum->atom);
+
+        if((k->flags & INSPECT_KEY_HIDDEN) || ((is_array || is_typedarray) && (k->flags & INSPECT_KEY_INTEGER)))
+          continue;
+
+        if(opts->exhausted)
+          break;
+
         if(pos > 0)
           dbuf_putstr(buf, compact ? ", " : ",");
         if(!compact && opts->break_length != INT32_MAX)
           inspect_newline(buf, INSPECT_LEVEL(opts) + 1);
-        if(!JS_IsSymbol(key) && (is_identifier(name) || is_integer(name))) {
-          dbuf_putstr(buf, name);
-        } else {
-          if(!JS_IsString(key))
-            dbuf_putc(buf, '[');
-          js_inspect_print(ctx, buf, key, opts, depth - 1);
-          if(!JS_IsString(key))
-            dbuf_putc(buf, ']');
-        }
+        inspect_flush(buf, opts, FALSE);
+        inspect_key_print(ctx, buf, k, opts, depth - 1);
         dbuf_putstr(buf, ": ");
-        js_cstring_free(ctx, name);
-        JS_FreeValue(ctx, key);
         JS_GetOwnProperty(ctx, &desc, value, propenum->atom);
         if(desc.flags & JS_PROP_GETSET)
           dbuf_put_colorstr(buf,
@@ -804,6 +1326,7 @@ js_inspect_print(JSContext* ctx, DynBuf* buf, JSValueConst value, inspect_option
     end_obj:
       if(!vector_empty(&propenum_tab))
         js_propertyenums_free(ctx, vector_begin(&propenum_tab), vector_size(&propenum_tab, sizeof(JSPropertyEnum)));
+      vector_free(&propenum_tab);
       break;
     }
 
@@ -815,57 +1338,991 @@ js_inspect_print(JSContext* ctx, DynBuf* buf, JSValueConst value, inspect_option
   return 0;
 }
 
-static JSValue
-js_inspect(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv) {
-  DynBuf dbuf;
-  inspect_options_t options;
-  int32_t level;
-  int optind = 1;
-  JSValue ret;
-
-  js_dbuf_init(ctx, &dbuf);
-  inspect_options_init(&options, ctx);
-
-  if(argc > 1 && JS_IsNumber(argv[1]))
-    optind++;
+static void
+inspect_json_string(DynBuf* buf, const char* str, size_t len) {
+  static const char hexdigits[] = "0123456789abcdef";
+  size_t i, start = 0;
+
+  dbuf_putc(buf, '"');
+
+  for(i = 0; i < len; i++) {
+    uint8_t c = str[i];
+    int e = 0;
+
+    switch(c) {
+      case '"': e = '"'; break;
+      case '\\': e = '\\'; break;
+      case '\b': e = 'b'; break;
+      case '\f': e = 'f'; break;
+      case '\n': e = 'n'; break;
+      case '\r': e = 'r'; break;
+      case '\t': e = 't'; break;
+      default: e = c < 0x20 ? 'u' : 0; break;
+    }
 
-  if(optind < argc)
-    inspect_options_get(&options, ctx, argv[optind]);
+    if(!e)
+      continue;
 
-  if(optind > 1) {
-    double d;
-    JS_ToFloat64(ctx, &d, argv[1]);
-    level = isinf(d) ? INT32_MAX : d;
-  } else
-    level = 0;
+    dbuf_put(buf, (const uint8_t*)&str[start], i - start);
+    dbuf_putc(buf, '\\');
+    dbuf_putc(buf, e);
 
-  // if(level)
-  // printf("js_inspect level: %d\n", level);
+    if(e == 'u') {
+      dbuf_putstr(buf, "00");
+      dbuf_putc(buf, hexdigits[c >> 4]);
+      dbuf_putc(buf, hexdigits[c & 0xf]);
+    }
+    start = i + 1;
+  }
 
-  js_inspect_print(ctx, &dbuf, argv[0], &options, options.depth - level);
+  dbuf_put(buf, (const uint8_t*)&str[start], len - start);
+  dbuf_putc(buf, '"');
+}
 
-  ret = JS_NewStringLen(ctx, (const char*)dbuf.buf, dbuf.size);
+static void
+inspect_json_value(JSContext* ctx, DynBuf* buf, JSValueConst value, int32_t max_length) {
+  const char* str;
+  size_t len;
 
-  dbuf_free(&dbuf);
+  if(!(str = JS_ToCStringLen(ctx, &len, value))) {
+    JS_FreeValue(ctx, JS_GetException(ctx));
+    dbuf_putstr(buf, "null");
+    return;
+  }
 
-  inspect_options_free(&options, ctx);
+  if(max_length >= 0 && len > (size_t)max_length) {
+    len = max_length;
+    /* don't cut an UTF-8 sequence */
+    while(len > 0 && (str[len] & 0xc0) == 0x80) len--;
+  }
 
-  return ret;
+  inspect_json_string(buf, str, len);
+  js_cstring_free(ctx, str);
 }
 
-const char*
-js_inspect_tostring(JSContext* ctx, JSValueConst value) {
-  JSValue output;
-  inspect_options_t opts;
-  JSValueConst args[] = {value, JS_UNDEFINED};
-  inspect_options_init(&opts, ctx);
-  opts.colors = FALSE;
-  args[1] = inspect_options_object(&opts, ctx);
-  inspect_options_free(&opts, ctx);
+/* values JSON has no notation for become { "$type": ..., "value": ... } */
+static void
+inspect_json_tagged(JSContext* ctx, DynBuf* buf, const char* type, JSValueConst value) {
+  dbuf_printf(buf, "{\"$type\":\"%s\"", type);
 
-  output = js_inspect(ctx, JS_UNDEFINED, 2, args);
-  JS_FreeValue(ctx, args[1]);
-  return JS_ToCString(ctx, output);
+  if(!JS_IsUndefined(value)) {
+    dbuf_putstr(buf, ",\"value\":");
+    inspect_json_value(ctx, buf, value, -1);
+  }
+  dbuf_putc(buf, '}');
+}
+
+static void
+inspect_json_number(JSContext* ctx, DynBuf* buf, JSValueConst value) {
+  double d;
+
+  if(JS_VALUE_GET_TAG(value) == JS_TAG_INT) {
+    dbuf_printf(buf, "%d", JS_VALUE_GET_INT(value));
+    return;
+  }
+
+  JS_ToFloat64(ctx, &d, value);
+
+  if(isfinite(d)) {
+    const char* str;
+    size_t len;
+
+    str = JS_ToCStringLen(ctx, &len, value);
+    dbuf_put(buf, (const uint8_t*)str, len);
+    js_cstring_free(ctx, str);
+  } else {
+    inspect_json_tagged(ctx, buf, "number", value);
+  }
+}
+
+/* Errors become { "$type": "Error", "name": ..., "message": ..., "stack": ... } */
+static void
+inspect_json_error(JSContext* ctx, DynBuf* buf, JSValueConst value) {
+  static const char* const props[] = {"name", "message", "stack"};
+  size_t i;
+
+  dbuf_putstr(buf, "{\"$type\":\"Error\"");
+
+  for(i = 0; i < countof(props); i++) {
+    JSValue prop = JS_GetPropertyStr(ctx, value, props[i]);
+
+    if(JS_IsException(prop)) {
+      JS_FreeValue(ctx, JS_GetException(ctx));
+      continue;
+    }
+
+    if(!JS_IsUndefined(prop)) {
+      dbuf_printf(buf, ",\"%s\":", props[i]);
+      inspect_json_value(ctx, buf, prop, -1);
+    }
+    JS_FreeValue(ctx, prop);
+  }
+  dbuf_putc(buf, '}');
+}
+
+/* renders 'value' as a single line of JSON, with the same traversal limits and cycle marking as js_inspect_print() */
+static int
+js_inspect_json(JSContext* ctx, DynBuf* buf, JSValueConst value, inspect_options_t* opts, int32_t depth) {
+  if(inspect_exhausted(buf, opts))
+    return 0;
+
+  switch(JS_VALUE_GET_TAG(value)) {
+    case JS_TAG_INT:
+    case JS_TAG_FLOAT64: {
+      inspect_json_number(ctx, buf, value);
+      break;
+    }
+
+    case JS_TAG_BIG_INT: inspect_json_tagged(ctx, buf, "bigint", value); break;
+    case JS_TAG_BIG_FLOAT: inspect_json_tagged(ctx, buf, "bigfloat", value); break;
+    case JS_TAG_BIG_DECIMAL: inspect_json_tagged(ctx, buf, "bigdecimal", value); break;
+    case JS_TAG_BOOL: dbuf_putstr(buf, JS_VALUE_GET_BOOL(value) ? "true" : "false"); break;
+    case JS_TAG_NULL: dbuf_putstr(buf, "null"); break;
+    case JS_TAG_UNDEFINED: inspect_json_tagged(ctx, buf, "undefined", JS_UNDEFINED); break;
+    case JS_TAG_EXCEPTION: inspect_json_tagged(ctx, buf, "exception", JS_UNDEFINED); break;
+
+    case JS_TAG_SYMBOL: {
+      JSValue str = js_symbol_to_string(ctx, value);
+      inspect_json_tagged(ctx, buf, "symbol", str);
+      JS_FreeValue(ctx, str);
+      break;
+    }
+
+    case JS_TAG_STRING: {
+      inspect_json_value(ctx, buf, value, opts->max_string_length == INT32_MAX ? -1 : opts->max_string_length);
+      break;
+    }
+
+    case JS_TAG_OBJECT: {
+      JSObject* p = JS_VALUE_GET_OBJ(value);
+      Vector propenum_tab;
+      JSPropertyEnum* propenum;
+      const char *s, *e;
+      uint32_t pos, len, limit, n = 0;
+      BOOL is_array, is_typedarray;
+
+      if(JS_IsFunction(ctx, value)) {
+        JSValue name = JS_GetPropertyStr(ctx, value, "name");
+        inspect_json_tagged(ctx, buf, "function", name);
+        JS_FreeValue(ctx, name);
+        break;
+      }
+
+      if(js_object_tmpmark_isset(value)) {
+        inspect_json_tagged(ctx, buf, "circular", JS_UNDEFINED);
+        break;
+      }
+
+      /* a Date is its time value, NaN for an invalid date */
+      if(p->class_id == JS_CLASS_DATE) {
+        dbuf_putstr(buf, "{\"$type\":\"Date\",\"value\":");
+        inspect_json_number(ctx, buf, p->u.object_data);
+        dbuf_putc(buf, '}');
+        break;
+      }
+
+      if(JS_IsError(ctx, value)) {
+        inspect_json_error(ctx, buf, value);
+        break;
+      }
+
+      is_array = JS_IsArray(ctx, value);
+      is_typedarray = p->class_id >= JS_CLASS_UINT8C_ARRAY && p->class_id <= JS_CLASS_FLOAT64_ARRAY;
+
+      if(depth < 0) {
+        inspect_json_tagged(ctx, buf, is_array || is_typedarray ? "array" : "object", JS_UNDEFINED);
+        break;
+      }
+
+      if(js_is_arraybuffer(ctx, value) || js_is_sharedarraybuffer(ctx, value)) {
+        static const char hexdigits[] = "0123456789abcdef";
+        size_t i, size;
+        uint8_t* ptr = JS_GetArrayBuffer(ctx, &size, value);
+
+        size_t n = ptr ? min_size(size, opts->max_array_length) : 0;
+
+        dbuf_printf(buf, "{\"$type\":\"ArrayBuffer\",\"byteLength\":%zu,\"value\":", size);
+
+        /* the hex string can't be cut, it's replaced by the marker when it doesn't fit */
+        if(!inspect_truncated(buf, opts, n * 2 + 2)) {
+          dbuf_putc(buf, '"');
+          for(i = 0; i < n; i++) {
+            dbuf_putc(buf, hexdigits[ptr[i] >> 4]);
+            dbuf_putc(buf, hexdigits[ptr[i] & 0xf]);
+          }
+          dbuf_putc(buf, '"');
+        }
+        dbuf_putc(buf, '}');
+        break;
+      }
+
+      if(js_is_regexp(ctx, value)) {
+        inspect_json_tagged(ctx, buf, "RegExp", value);
+        break;
+      }
+
+      if(js_is_map(ctx, value) || js_is_set(ctx, value)) {
+        BOOL is_map = js_is_map(ctx, value);
+        Vector entries = VECTOR(ctx);
+        JSValue* entry;
+        int64_t count;
+
+        if((count = inspect_map_entries(ctx, value, &entries, opts->max_array_length)) < 0) {
+          vector_free(&entries);
+          return -1;
+        }
+
+        js_object_tmpmark_set(value);
+        dbuf_printf(buf, "{\"$type\":\"%s\",\"value\":[", is_map ? "Map" : "Set");
+
+        for(entry = vector_begin(&entries); entry != vector_end(&entries) && !opts->exhausted; entry += 2, n++) {
+          if(n)
+            dbuf_putc(buf, ',');
+          inspect_flush(buf, opts, FALSE);
+
+          if(is_map) {
+            dbuf_putc(buf, '[');
+            js_inspect_json(ctx, buf, entry[0], opts, depth - 1);
+            dbuf_putc(buf, ',');
+            js_inspect_json(ctx, buf, entry[1], opts, depth - 1);
+            dbuf_putc(buf, ']');
+          } else {
+            js_inspect_json(ctx, buf, entry[0], opts, depth - 1);
+          }
+        }
+
+        if(count > n && !opts->exhausted)
+          dbuf_printf(buf, "%s{\"$more\":%" PRId64 "}", n ? "," : "", count - n);
+
+        inspect_map_entries_free(ctx, &entries);
+        js_object_tmpmark_clear(value);
+        dbuf_putstr(buf, "]}");
+        break;
+      }
+
+      vector_init(&propenum_tab, ctx);
+
+      if(js_object_getpropertynames(ctx,
+                                    &propenum_tab,
+                                    value,
+                                    JS_GPN_STRING_MASK | JS_GPN_SYMBOL_MASK |
+                                        (opts->show_hidden ? 0 : JS_GPN_ENUM_ONLY))) {
+        vector_free(&propenum_tab);
+        return -1;
+      }
+
+      js_object_tmpmark_set(value);
+
+      if(is_array || is_typedarray) {
+        len = js_array_length(ctx, value);
+        limit = min_size(opts->max_array_length, len);
+        dbuf_putc(buf, '[');
+
+        for(pos = 0; pos < limit && !opts->exhausted; pos++) {
+          JSValue element;
+
+          if(pos > 0)
+            dbuf_putc(buf, ',');
+          inspect_flush(buf, opts, FALSE);
+
+          if(is_typedarray && pos < p->u.array.count)
+            element = js_typedarray_get(ctx, p, pos);
+          else if(p->fast_array && p->class_id == JS_CLASS_ARRAY && pos < p->u.array.count)
+            element = JS_DupValue(ctx, p->u.array.u.values[pos]);
+          else
+            element = JS_GetPropertyUint32(ctx, value, pos);
+
+          js_inspect_json(ctx, buf, element, opts, depth - 1);
+          JS_FreeValue(ctx, element);
+        }
+
+        if(limit < len)
+          dbuf_printf(buf, "%s{\"$more\":%u}", limit ? "," : "", len - limit);
+
+        dbuf_putc(buf, ']');
+      } else {
+        dbuf_putc(buf, '{');
+
+        /* class instances say what they are */
+        if((s = js_object_tostring(ctx, value))) {
+          if(!strncmp(s, "[object ", 8) && (e = strchr(s, ']')) && !(e - (s + 8) == 6 && !memcmp(s + 8, "Object", 6))) {
+            dbuf_putstr(buf, "\"$class\":");
+            inspect_json_string(buf, s + 8, e - (s + 8));
+            n++;
+          }
+          js_cstring_free(ctx, s);
+        }
+
+        vector_foreach_t(&propenum_tab, propenum) {
+          JSPropertyDescriptor desc;
+          JSValue key;
+
+          if(inspect_options_hidden(opts, propenum->atom))
+            continue;
+
+          if(opts->exhausted)
+            break;
+
+          if(n++ > 0)
+            dbuf_putc(buf, ',');
+          inspect_flush(buf, opts, FALSE);
+
+          key = js_atom_tovalue(ctx, propenum->atom);
+
+          if(JS_IsSymbol(key)) {
+            JSValue str = js_symbol_to_string(ctx, key);
+            DynBuf name;
+            size_t slen;
+
+            js_dbuf_init(ctx, &name);
+            dbuf_putc(&name, '[');
+            if((s = JS_ToCStringLen(ctx, &slen, str))) {
+              dbuf_put(&name, (const uint8_t*)s, slen);
+              js_cstring_free(ctx, s);
+            }
+            dbuf_putc(&name, ']');
+            inspect_json_string(buf, (const char*)name.buf, name.size);
+            dbuf_free(&name);
+            JS_FreeValue(ctx, str);
+          } else {
+            inspect_json_value(ctx, buf, key, -1);
+          }
+          JS_FreeValue(ctx, key);
+          dbuf_putc(buf, ':');
+
+          memset(&desc, 0, sizeof(desc));
+          desc.value = desc.getter = desc.setter = JS_UNDEFINED;
+
+          if(JS_GetOwnProperty(ctx, &desc, value, propenum->atom) != 1)
+            dbuf_putstr(buf, "null");
+          else if(desc.flags & JS_PROP_GETSET)
+            inspect_json_tagged(ctx, buf, JS_IsUndefined(desc.getter) ? "setter" : "getter", JS_UNDEFINED);
+          else
+            js_inspect_json(ctx, buf, desc.value, opts, depth - 1);
+
+          js_propertydescriptor_free(ctx, &desc);
+        }
+        dbuf_putc(buf, '}');
+      }
+
+      js_object_tmpmark_clear(value);
+      js_propertyenums_free(ctx, vector_begin(&propenum_tab), vector_size(&propenum_tab, sizeof(JSPropertyEnum)));
+      vector_free(&propenum_tab);
+      break;
+    }
+
+    default: {
+      dbuf_putstr(buf, "null");
+      break;
+    }
+  }
+  return 0;
+}
+
+static int
+js_inspect_value(JSContext* ctx, DynBuf* buf, JSValueConst value, inspect_options_t* opts, int32_t depth) {
+  if(opts->format == INSPECT_FORMAT_JSON)
+    return js_inspect_json(ctx, buf, value, opts, depth);
+
+  return js_inspect_print(ctx, buf, value, opts, depth);
+}
+
+/* when argv[optind] is an InspectOptions object, copies its options into 'opts' (sharing hide_keys, so they must
+ * not be freed) and returns them. otherwise 'opts' gets the defaults. */
+static inspect_options_t*
+inspect_options_compiled(JSContext* ctx, int argc, JSValueConst* argv, int optind, inspect_options_t* opts) {
+  inspect_options_t* compiled;
+
+  if(optind < argc && (compiled = JS_GetOpaque(argv[optind], js_inspect_options_class_id))) {
+    memcpy(opts, compiled, sizeof(inspect_options_t));
+    return compiled;
+  }
+
+  inspect_options_init(opts, ctx);
+  return 0;
+}
+
+/* inspect.compileOptions(options): parses the options once, the result is passed instead of them */
+static JSValue
+js_inspect_compile_options(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv) {
+  inspect_options_t* opts;
+  JSValue obj;
+
+  if(!(opts = js_malloc(ctx, sizeof(inspect_options_t))))
+    return JS_EXCEPTION;
+
+  inspect_options_init(opts, ctx);
+  /* it outlives this call, so don't tie it to the context */
+  opts->hide_keys = VECTOR_RT(JS_GetRuntime(ctx));
+
+  if(argc > 0 && JS_IsObject(argv[0]))
+    inspect_options_get(opts, ctx, argv[0]);
+
+  obj = JS_NewObjectClass(ctx, js_inspect_options_class_id);
+
+  if(JS_IsException(obj)) {
+    inspect_options_free(opts, ctx);
+    js_free(ctx, opts);
+    return obj;
+  }
+
+  JS_SetOpaque(obj, opts);
+  return obj;
+}
+
+static JSValue
+js_inspect_options_object(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv) {
+  inspect_options_t* opts;
+
+  if(!(opts = JS_GetOpaque2(ctx, this_val, js_inspect_options_class_id)))
+    return JS_EXCEPTION;
+
+  return inspect_options_object(opts, ctx);
+}
+
+static void
+js_inspect_options_finalizer(JSRuntime* rt, JSValue val) {
+  inspect_options_t* opts;
+
+  if((opts = JS_GetOpaque(val, js_inspect_options_class_id))) {
+    inspect_options_free_rt(opts, rt);
+    js_free_rt(rt, opts);
+  }
+}
+
+static JSClassDef js_inspect_options_class = {
+    .class_name = "InspectOptions",
+    .finalizer = js_inspect_options_finalizer,
+};
+
+static const JSCFunctionListEntry js_inspect_options_funcs[] = {
+    JS_CFUNC_DEF("toObject", 0, js_inspect_options_object),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "InspectOptions", JS_PROP_CONFIGURABLE),
+};
+
+static JSValue
+js_inspect(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv) {
+  DynBuf dbuf;
+  inspect_options_t options, *compiled;
+  inspect_keys_t keys;
+  int32_t level;
+  int optind = 1;
+  JSValue ret;
+
+  js_dbuf_init(ctx, &dbuf);
+
+  if(argc > 1 && JS_IsNumber(argv[1]))
+    optind++;
+
+  if(!(compiled = inspect_options_compiled(ctx, argc, argv, optind, &options)))
+    if(optind < argc)
+      inspect_options_get(&options, ctx, argv[optind]);
+
+  if(optind > 1) {
+    double d;
+    JS_ToFloat64(ctx, &d, argv[1]);
+    level = isinf(d) ? INT32_MAX : d;
+  } else
+    level = 0;
+
+  // if(level)
+  // printf("js_inspect level: %d\n", level);
+
+  inspect_keys_init(&keys, JS_GetRuntime(ctx));
+  options.keys = &keys;
+
+  js_inspect_value(ctx, &dbuf, argv[0], &options, options.depth - level);
+
+  ret = JS_NewStringLen(ctx, (const char*)dbuf.buf, dbuf.size);
+
+  dbuf_free(&dbuf);
+  inspect_keys_free(&keys, JS_GetRuntime(ctx));
+
+  if(!compiled)
+    inspect_options_free(&options, ctx);
+
+  return ret;
+}
+
+/* inspect.write(fd, value[, options]): renders 'value' straight to 'fd', returns the number of bytes written */
+static JSValue
+js_inspect_write(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv) {
+  DynBuf output, *buf = &output;
+  inspect_options_t options, *compiled;
+  inspect_keys_t keys;
+  JSValue ret;
+
+  /* it never holds more than INSPECT_FLUSH_SIZE and a line, and it's per call as runtimes can run on several threads */
+  js_dbuf_init(ctx, buf);
+
+  if(!(compiled = inspect_options_compiled(ctx, argc, argv, 2, &options)))
+    if(argc > 2)
+      inspect_options_get(&options, ctx, argv[2]);
+
+  JS_ToInt32(ctx, &options.fd, argv[0]);
+
+  inspect_keys_init(&keys, JS_GetRuntime(ctx));
+  options.keys = &keys;
+
+  js_inspect_value(ctx, buf, argv[1], &options, options.depth);
+  inspect_keys_free(&keys, JS_GetRuntime(ctx));
+
+  /* one record per line (NDJSON) */
+  if(options.format == INSPECT_FORMAT_JSON)
+    dbuf_putc(buf, '\n');
+
+  inspect_flush(buf, &options, TRUE);
+
+  if(options.written < 0)
+    ret = JS_ThrowInternalError(ctx, "inspect.write(%d): %s", options.fd, strerror(options.error));
+  else
+    ret = JS_NewInt64(ctx, options.written);
+
+  if(!compiled)
+    inspect_options_free(&options, ctx);
+
+  dbuf_free(buf);
+  return ret;
+}
+
+/* number of entries up to which objects without nested objects are printed in one piece by InspectCursor */
+#define INSPECT_CURSOR_INLINE 8
+
+enum { INSPECT_FRAME_OBJECT = 0, INSPECT_FRAME_ARRAY, INSPECT_FRAME_MAP, INSPECT_FRAME_SET };
+
+/* an object the cursor is in the middle of */
+typedef struct {
+  JSValue obj;
+  int kind;
+  Vector items;        /* JSPropertyEnum for objects, key/value pairs for Map and Set */
+  uint32_t pos, limit; /* next item, number of items to print */
+  int64_t count;       /* number of items in total */
+  BOOL last;           /* last item of the parent, no comma after it */
+} inspect_frame_t;
+
+typedef struct {
+  inspect_options_t opts;
+  JSValue options; /* the InspectOptions object, when they are compiled */
+  inspect_keys_t keys;
+  Vector frames;
+  DynBuf pending; /* rendered, but not yet returned */
+  size_t pending_pos;
+  JSValue root;
+  BOOL started, done;
+} InspectCursor;
+
+static JSClassID js_inspect_cursor_class_id;
+
+static void
+inspect_frame_free(inspect_frame_t* frame, JSRuntime* rt) {
+  if(frame->kind == INSPECT_FRAME_OBJECT) {
+    JSPropertyEnum* propenum;
+    vector_foreach_t(&frame->items, propenum) { JS_FreeAtomRT(rt, propenum->atom); }
+  } else {
+    JSValue* entry;
+    vector_foreach_t(&frame->items, entry) { JS_FreeValueRT(rt, *entry); }
+  }
+
+  vector_free(&frame->items);
+  JS_FreeValueRT(rt, frame->obj);
+}
+
+static void
+inspect_indent(DynBuf* buf, int32_t level) {
+  while(level-- > 0) dbuf_putstr(buf, "  ");
+}
+
+static BOOL
+inspect_has_custom(JSContext* ctx, JSValueConst obj) {
+  JSAtom inspect_custom = js_inspect_custom_atom(ctx, 0), inspect_custom_node = js_inspect_custom_atom(ctx, "nodejs.util.inspect.custom");
+  BOOL ret = JS_HasProperty(ctx, obj, inspect_custom) > 0 || JS_HasProperty(ctx, obj, inspect_custom_node) > 0;
+
+  JS_FreeAtom(ctx, inspect_custom);
+  JS_FreeAtom(ctx, inspect_custom_node);
+  return ret;
+}
+
+/* which kind of frame the cursor enters for 'value', or -1 if it is printed in one piece */
+static int
+inspect_cursor_kind(JSContext* ctx, InspectCursor* ic, JSValueConst value, int32_t depth) {
+  JSObject* p;
+  int kind;
+  int64_t count;
+
+  if(!JS_IsObject(value) || depth <= 0 || js_object_tmpmark_isset(value))
+    return -1;
+
+  p = JS_VALUE_GET_OBJ(value);
+
+  switch(p->class_id) {
+    case JS_CLASS_OBJECT: kind = INSPECT_FRAME_OBJECT; count = p->shape->prop_count; break;
+    case JS_CLASS_ARRAY:
+    case JS_CLASS_ARGUMENTS: kind = INSPECT_FRAME_ARRAY; count = js_array_length(ctx, value); break;
+    case JS_CLASS_MAP: kind = INSPECT_FRAME_MAP; count = p->u.map_state->record_count; break;
+    case JS_CLASS_SET: kind = INSPECT_FRAME_SET; count = p->u.map_state->record_count; break;
+    default: return -1;
+  }
+
+  if(ic->opts.custom_inspect && inspect_has_custom(ctx, value))
+    return -1;
+
+  /* small and flat, fits on a line */
+  if(count <= INSPECT_CURSOR_INLINE && kind <= INSPECT_FRAME_ARRAY) {
+    int64_t width = ic->opts.break_length == INT32_MAX ? INT64_MAX : ic->opts.break_length;
+
+    if(inspect_fits(JS_GetRuntime(ctx), value, 1, &width, ic->opts.show_hidden))
+      return -1;
+  }
+
+  return kind;
+}
+
+static void
+inspect_cursor_enter(JSContext* ctx, InspectCursor* ic, JSValueConst value, int kind, BOOL last) {
+  inspect_options_t* opts = &ic->opts;
+  inspect_frame_t* frame;
+
+  if(!(frame = vector_emplace(&ic->frames, sizeof(inspect_frame_t))))
+    return;
+
+  frame->obj = JS_DupValue(ctx, value);
+  frame->kind = kind;
+  frame->items = VECTOR_RT(JS_GetRuntime(ctx));
+  frame->pos = 0;
+  frame->last = last;
+
+  switch(kind) {
+    case INSPECT_FRAME_OBJECT: {
+      JSPropertyEnum *propenum, *out;
+
+      js_object_getpropertynames(ctx,
+                                 &frame->items,
+                                 value,
+                                 JS_GPN_STRING_MASK | JS_GPN_SYMBOL_MASK | (opts->show_hidden ? 0 : JS_GPN_ENUM_ONLY));
+
+      /* leave out the hidden keys, so the last one that's printed is known */
+      out = vector_begin(&frame->items);
+      vector_foreach_t(&frame->items, propenum) {
+        if(inspect_key_get(ctx, opts, propenum->atom)->flags & INSPECT_KEY_HIDDEN)
+          JS_FreeAtom(ctx, propenum->atom);
+        else
+          *out++ = *propenum;
+      }
+      vector_shrink(&frame->items, sizeof(JSPropertyEnum), out - (JSPropertyEnum*)vector_begin(&frame->items));
+      frame->count = frame->limit = vector_size(&frame->items, sizeof(JSPropertyEnum));
+      dbuf_putc(&ic->pending, '{');
+      break;
+    }
+    case INSPECT_FRAME_ARRAY: {
+      frame->count = js_array_length(ctx, value);
+      frame->limit = min_size(frame->count, opts->max_array_length);
+      dbuf_putc(&ic->pending, '[');
+      break;
+    }
+    case INSPECT_FRAME_MAP:
+    case INSPECT_FRAME_SET: {
+      frame->count = inspect_map_entries(ctx, value, &frame->items, opts->max_array_length);
+      frame->limit = vector_size(&frame->items, sizeof(JSValue) * 2);
+      dbuf_putstr(&ic->pending, kind == INSPECT_FRAME_MAP ? "Map {" : "Set [");
+      break;
+    }
+  }
+
+  js_object_tmpmark_set(value);
+}
+
+/* prints 'value' after the key: opens a frame for it, or prints it in one piece */
+static void
+inspect_cursor_value(JSContext* ctx, InspectCursor* ic, JSValueConst value, BOOL last) {
+  int32_t depth = ic->opts.depth - vector_size(&ic->frames, sizeof(inspect_frame_t));
+  int kind;
+
+  if((kind = inspect_cursor_kind(ctx, ic, value, depth)) >= 0) {
+    inspect_cursor_enter(ctx, ic, value, kind, last);
+  } else {
+    if(JS_IsObject(value) && js_object_tmpmark_isset(value))
+      dbuf_put_colorstr(&ic->pending, "[Circular]", COLOR_MARINE, ic->opts.colors);
+    else
+      js_inspect_print(ctx, &ic->pending, value, &ic->opts, depth);
+
+    if(!last)
+      dbuf_putc(&ic->pending, ',');
+  }
+
+  dbuf_putc(&ic->pending, '\n');
+}
+
+/* renders the next item (or the closing bracket) of the innermost frame into ic->pending */
+static void
+inspect_cursor_step(JSContext* ctx, InspectCursor* ic) {
+  inspect_options_t* opts = &ic->opts;
+  DynBuf* buf = &ic->pending;
+  inspect_frame_t* frame;
+  int32_t level = vector_size(&ic->frames, sizeof(inspect_frame_t)), depth = opts->depth - level;
+  JSValue value = JS_UNDEFINED;
+  BOOL last;
+
+  if(!ic->started) {
+    ic->started = TRUE;
+    inspect_cursor_value(ctx, ic, ic->root, TRUE);
+    return;
+  }
+
+  if(level == 0) {
+    ic->done = TRUE;
+    return;
+  }
+
+  frame = vector_back(&ic->frames, sizeof(inspect_frame_t));
+
+  if(frame->pos >= frame->limit) {
+    if(frame->count > frame->limit) {
+      inspect_indent(buf, level);
+      dbuf_printf(buf, "... %" PRId64 " more item%s\n", frame->count - frame->limit, frame->count - frame->limit > 1 ? "s" : "");
+      frame->count = frame->limit;
+      return;
+    }
+
+    inspect_indent(buf, level - 1);
+    dbuf_putstr(buf, frame->kind == INSPECT_FRAME_ARRAY || frame->kind == INSPECT_FRAME_SET ? "]" : "}");
+    if(!frame->last)
+      dbuf_putc(buf, ',');
+    dbuf_putc(buf, '\n');
+
+    js_object_tmpmark_clear(frame->obj);
+    inspect_frame_free(frame, JS_GetRuntime(ctx));
+    vector_pop(&ic->frames, sizeof(inspect_frame_t));
+    return;
+  }
+
+  inspect_indent(buf, level);
+
+  switch(frame->kind) {
+    case INSPECT_FRAME_OBJECT: {
+      JSPropertyEnum* propenum = vector_at(&frame->items, sizeof(JSPropertyEnum), frame->pos);
+      JSPropertyDescriptor desc;
+
+      inspect_key_print(ctx, buf, inspect_key_get(ctx, opts, propenum->atom), opts, depth);
+      dbuf_putstr(buf, ": ");
+
+      if(JS_GetOwnProperty(ctx, &desc, frame->obj, propenum->atom) == 1) {
+        if(desc.flags & JS_PROP_GETSET)
+          value = JS_NewString(ctx,
+                               JS_IsUndefined(desc.getter)   ? "[Setter]"
+                               : JS_IsUndefined(desc.setter) ? "[Getter]"
+                                                             : "[Getter/Setter]");
+        else
+          value = JS_DupValue(ctx, desc.value);
+
+        js_propertydescriptor_free(ctx, &desc);
+      }
+      break;
+    }
+    case INSPECT_FRAME_ARRAY: {
+      value = JS_GetPropertyUint32(ctx, frame->obj, frame->pos);
+      break;
+    }
+    case INSPECT_FRAME_MAP: {
+      JSValue* entry = vector_at(&frame->items, sizeof(JSValue) * 2, frame->pos);
+
+      js_inspect_print(ctx, buf, entry[0], opts, depth);
+      dbuf_putstr(buf, " => ");
+      value = JS_DupValue(ctx, entry[1]);
+      break;
+    }
+    case INSPECT_FRAME_SET: {
+      JSValue* entry = vector_at(&frame->items, sizeof(JSValue) * 2, frame->pos);
+
+      value = JS_DupValue(ctx, entry[0]);
+      break;
+    }
+  }
+
+  /* 'frame' moves when the vector grows */
+  last = ++frame->pos >= frame->limit && frame->count <= frame->limit;
+
+  inspect_cursor_value(ctx, ic, value, last);
+  JS_FreeValue(ctx, value);
+}
+
+/* returns the next line, or undefined after the last one */
+static JSValue
+inspect_cursor_line(JSContext* ctx, InspectCursor* ic) {
+  DynBuf* buf = &ic->pending;
+  inspect_frame_t* frame;
+  uint8_t *start, *eol = 0;
+  JSValue ret = JS_UNDEFINED;
+
+  /* the marks for cycle detection are only set while rendering, an unfinished cursor doesn't leave them behind */
+  vector_foreach_t(&ic->frames, frame) { js_object_tmpmark_set(frame->obj); }
+
+  while(!(eol = memchr(buf->buf + ic->pending_pos, '\n', buf->size - ic->pending_pos)) && !ic->done)
+    inspect_cursor_step(ctx, ic);
+
+  vector_foreach_t(&ic->frames, frame) { js_object_tmpmark_clear(frame->obj); }
+
+  start = buf->buf + ic->pending_pos;
+
+  if(eol || buf->size > ic->pending_pos) {
+    if(!eol)
+      eol = buf->buf + buf->size;
+
+    ret = JS_NewStringLen(ctx, (const char*)start, eol - start);
+    ic->pending_pos = eol - buf->buf + (eol < buf->buf + buf->size);
+  }
+
+  if(ic->pending_pos == buf->size)
+    buf->size = ic->pending_pos = 0;
+
+  return ret;
+}
+
+/* inspect.cursor(value[, options]): renders 'value' a line at a time, as far as the lines are read */
+static JSValue
+js_inspect_cursor(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv) {
+  JSRuntime* rt = JS_GetRuntime(ctx);
+  InspectCursor* ic;
+  JSValue obj;
+
+  obj = JS_NewObjectClass(ctx, js_inspect_cursor_class_id);
+
+  if(JS_IsException(obj))
+    return obj;
+
+  if(!(ic = js_mallocz(ctx, sizeof(InspectCursor)))) {
+    JS_FreeValue(ctx, obj);
+    return JS_EXCEPTION;
+  }
+
+  if(inspect_options_compiled(ctx, argc, argv, 1, &ic->opts)) {
+    ic->options = JS_DupValue(ctx, argv[1]);
+  } else {
+    /* it outlives this call, so don't tie it to the context */
+    vector_free(&ic->opts.hide_keys);
+    ic->opts.hide_keys = VECTOR_RT(rt);
+    ic->options = JS_UNDEFINED;
+
+    if(argc > 1 && JS_IsObject(argv[1]))
+      inspect_options_get(&ic->opts, ctx, argv[1]);
+  }
+
+  ic->opts.format = INSPECT_FORMAT_TEXT;
+  ic->opts.keys = &ic->keys;
+  inspect_keys_init(&ic->keys, rt);
+  ic->frames = VECTOR_RT(rt);
+  js_dbuf_init_rt(rt, &ic->pending);
+  ic->root = argc > 0 ? JS_DupValue(ctx, argv[0]) : JS_UNDEFINED;
+
+  JS_SetOpaque(obj, ic);
+  return obj;
+}
+
+enum { CURSOR_NEXT = 0, CURSOR_READ };
+
+static JSValue
+js_inspect_cursor_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv, int magic) {
+  InspectCursor* ic;
+  JSValue ret = JS_UNDEFINED;
+
+  if(!(ic = JS_GetOpaque2(ctx, this_val, js_inspect_cursor_class_id)))
+    return JS_EXCEPTION;
+
+  switch(magic) {
+    case CURSOR_NEXT: {
+      JSValue line = inspect_cursor_line(ctx, ic);
+
+      ret = JS_NewObject(ctx);
+      JS_SetPropertyStr(ctx, ret, "done", JS_NewBool(ctx, JS_IsUndefined(line)));
+      JS_SetPropertyStr(ctx, ret, "value", line);
+      break;
+    }
+    case CURSOR_READ: {
+      uint32_t i, n = 1;
+
+      if(argc > 0)
+        JS_ToUint32(ctx, &n, argv[0]);
+
+      ret = JS_NewArray(ctx);
+
+      for(i = 0; i < n; i++) {
+        JSValue line = inspect_cursor_line(ctx, ic);
+
+        if(JS_IsUndefined(line))
+          break;
+
+        JS_SetPropertyUint32(ctx, ret, i, line);
+      }
+      break;
+    }
+  }
+
+  return ret;
+}
+
+static JSValue
+js_inspect_cursor_done(JSContext* ctx, JSValueConst this_val) {
+  InspectCursor* ic;
+
+  if(!(ic = JS_GetOpaque2(ctx, this_val, js_inspect_cursor_class_id)))
+    return JS_EXCEPTION;
+
+  /* all lines read, and nothing left to render */
+  return JS_NewBool(ctx,
+                    (ic->done || (ic->started && vector_empty(&ic->frames))) && ic->pending_pos == ic->pending.size);
+}
+
+static JSValue
+js_inspect_cursor_iterator(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv) {
+  return JS_DupValue(ctx, this_val);
+}
+
+static void
+js_inspect_cursor_finalizer(JSRuntime* rt, JSValue val) {
+  InspectCursor* ic;
+  inspect_frame_t* frame;
+
+  if((ic = JS_GetOpaque(val, js_inspect_cursor_class_id))) {
+    vector_foreach_t(&ic->frames, frame) { inspect_frame_free(frame, rt); }
+    vector_free(&ic->frames);
+
+    if(JS_IsUndefined(ic->options))
+      inspect_options_free_rt(&ic->opts, rt);
+    else
+      JS_FreeValueRT(rt, ic->options);
+
+    inspect_keys_free(&ic->keys, rt);
+    dbuf_free(&ic->pending);
+    JS_FreeValueRT(rt, ic->root);
+    js_free_rt(rt, ic);
+  }
+}
+
+static JSClassDef js_inspect_cursor_class = {
+    .class_name = "InspectCursor",
+    .finalizer = js_inspect_cursor_finalizer,
+};
+
+static const JSCFunctionListEntry js_inspect_cursor_funcs[] = {
+    JS_CFUNC_MAGIC_DEF("next", 0, js_inspect_cursor_method, CURSOR_NEXT),
+    JS_CFUNC_MAGIC_DEF("read", 1, js_inspect_cursor_method, CURSOR_READ),
+    JS_CGETSET_DEF("done", js_inspect_cursor_done, 0),
+    JS_CFUNC_DEF("[Symbol.iterator]", 0, js_inspect_cursor_iterator),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "InspectCursor", JS_PROP_CONFIGURABLE),
+};
+
+const char*
+js_inspect_tostring(JSContext* ctx, JSValueConst value) {
+  JSValue output;
+  inspect_options_t opts;
+  JSValueConst args[] = {value, JS_UNDEFINED};
+  inspect_options_init(&opts, ctx);
+  opts.colors = FALSE;
+  args[1] = inspect_options_object(&opts, ctx);
+  inspect_options_free(&opts, ctx);
+
+  output = js_inspect(ctx, JS_UNDEFINED, 2, args);
+  JS_FreeValue(ctx, args[1]);
+  return JS_ToCString(ctx, output);
 }
 
 JSValue js_debugger_build_backtrace(JSContext* ctx, const uint8_t* cur_pc);
@@ -893,9 +2350,26 @@ static const JSCFunctionListEntry js_inspect_funcs[] = {
 
 static int
 js_inspect_init(JSContext* ctx, JSModuleDef* m) {
-  JSValue inspect, inspect_symbol, symbol_ctor;
+  JSValue inspect, inspect_symbol, symbol_ctor, options_proto, cursor_proto;
+
+  JS_NewClassID(&js_inspect_options_class_id);
+  JS_NewClass(JS_GetRuntime(ctx), js_inspect_options_class_id, &js_inspect_options_class);
+
+  options_proto = JS_NewObject(ctx);
+  JS_SetPropertyFunctionList(ctx, options_proto, js_inspect_options_funcs, countof(js_inspect_options_funcs));
+  JS_SetClassProto(ctx, js_inspect_options_class_id, options_proto);
+
+  JS_NewClassID(&js_inspect_cursor_class_id);
+  JS_NewClass(JS_GetRuntime(ctx), js_inspect_cursor_class_id, &js_inspect_cursor_class);
+
+  cursor_proto = JS_NewObject(ctx);
+  JS_SetPropertyFunctionList(ctx, cursor_proto, js_inspect_cursor_funcs, countof(js_inspect_cursor_funcs));
+  JS_SetClassProto(ctx, js_inspect_cursor_class_id, cursor_proto);
 
   inspect = JS_NewCFunction(ctx, js_inspect, "inspect", 2);
+  JS_SetPropertyStr(ctx, inspect, "compileOptions", JS_NewCFunction(ctx, js_inspect_compile_options, "compileOptions", 1));
+  JS_SetPropertyStr(ctx, inspect, "write", JS_NewCFunction(ctx, js_inspect_write, "write", 2));
+  JS_SetPropertyStr(ctx, inspect, "cursor", JS_NewCFunction(ctx, js_inspect_cursor, "cursor", 1));
 
   inspect_symbol = js_symbol_for(ctx, "quickjs.inspect.custom");
   JS_SetPropertyStr(ctx, inspect, "symbol", JS_DupValue(ctx, inspect_symbol));
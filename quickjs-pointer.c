@@ -6,8 +6,8 @@
 #include "utils.h"
 #include <string.h>
 
-VISIBLE JSClassID js_pointer_class_id = 0;
-static JSValue pointer_proto, pointer_ctor;
+VISIBLE JSClassID js_pointer_class_id = 0, js_pointer_set_class_id = 0, js_pointer_cache_class_id = 0;
+static JSValue pointer_proto, pointer_ctor, pointer_set_proto;
 
 enum pointer_methods {
   METHOD_DEREF = 0,
@@ -19,7 +19,7 @@ enum pointer_methods {
   METHOD_KEYS,
   METHOD_VALUES
 };
-enum pointer_functions { STATIC_FROM = 0, STATIC_OF };
+enum pointer_functions { STATIC_FROM = 0, STATIC_OF, STATIC_COMPILE_SET };
 enum pointer_getters { PROP_LENGTH = 0, PROP_PATH };
 
 JSValue
@@ -194,6 +194,146 @@ js_pointer_set(JSContext* ctx, JSValueConst this_val, JSValueConst value, int ma
   return JS_UNDEFINED;
 }
 
+/* compiles an array of pointers (Pointer objects, strings or arrays) into a PointerSet */
+static JSValue
+js_pointer_set_new(JSContext* ctx, JSValueConst array) {
+  PointerSet* set = 0;
+  Pointer** ptrs = 0;
+  JSValue obj = JS_EXCEPTION;
+  int64_t i, n;
+
+  if((n = js_array_length(ctx, array)) < 0)
+    return JS_ThrowTypeError(ctx, "Pointer.compileSet: argument 1 must be an array");
+
+  if(!(ptrs = js_mallocz(ctx, sizeof(Pointer*) * (n + 1))))
+    return JS_EXCEPTION;
+
+  for(i = 0; i < n; i++) {
+    JSValue item = JS_GetPropertyUint32(ctx, array, i);
+    Pointer* ptr;
+    BOOL ok;
+
+    if((ptr = JS_GetOpaque(item, js_pointer_class_id)))
+      ok = !!(ptrs[i] = pointer_dup(ptr, ctx));
+    else if((ok = !!(ptrs[i] = pointer_new(ctx))) && !(ok = pointer_from(ptrs[i], ctx, item, 0)))
+      JS_ThrowTypeError(ctx, "Pointer.compileSet: element %" PRId64 " unknown type", i);
+
+    JS_FreeValue(ctx, item);
+
+    if(!ok)
+      goto fail;
+  }
+
+  if(!(set = js_mallocz(ctx, sizeof(PointerSet))))
+    goto fail;
+
+  if(pointer_set_compile(set, ctx, ptrs, n))
+    goto fail;
+
+  if(!(set->names = js_mallocz(ctx, sizeof(JSAtom) * (n + 1))))
+    goto fail;
+
+  for(i = 0; i < n; i++) {
+    DynBuf dbuf;
+
+    js_dbuf_init(ctx, &dbuf);
+    pointer_tostring(ptrs[i], ctx, &dbuf);
+    set->names[i] = JS_NewAtomLen(ctx, (const char*)dbuf.buf, dbuf.size);
+    dbuf_free(&dbuf);
+  }
+
+  obj = JS_NewObjectProtoClass(ctx, pointer_set_proto, js_pointer_set_class_id);
+
+  if(!JS_IsException(obj)) {
+    JS_SetOpaque(obj, set);
+    set = 0;
+  }
+
+fail:
+  if(set) {
+    pointer_set_free(set, JS_GetRuntime(ctx));
+    js_free(ctx, set);
+  }
+
+  for(i = 0; i < n; i++)
+    if(ptrs[i])
+      pointer_free(ptrs[i], ctx);
+
+  js_free(ctx, ptrs);
+  return obj;
+}
+
+/* extracts all the pointers from 'obj' into a new array, or into 'target': by index when it is an array, else by the
+ * pointer strings */
+static JSValue
+js_pointer_set_extract(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv) {
+  PointerSet* set;
+  JSValue *values, ret;
+  uint32_t i;
+
+  if(!(set = JS_GetOpaque2(ctx, this_val, js_pointer_set_class_id)))
+    return JS_EXCEPTION;
+
+  if(!(values = js_malloc(ctx, sizeof(JSValue) * (set->noutputs + 1))))
+    return JS_EXCEPTION;
+
+  for(i = 0; i < set->noutputs; i++) values[i] = JS_UNDEFINED;
+
+  if(pointer_set_extract(set, ctx, argv[0], values)) {
+    js_values_free(JS_GetRuntime(ctx), set->noutputs, values);
+    js_free(ctx, values);
+    return JS_EXCEPTION;
+  }
+
+  if(argc > 1 && JS_IsObject(argv[1])) {
+    BOOL is_array = JS_IsArray(ctx, argv[1]);
+    int r = 0;
+
+    /* setters and Proxy traps of the target can throw, the values not stored yet are freed then */
+    for(i = 0; i < set->noutputs; i++) {
+      if(r < 0)
+        JS_FreeValue(ctx, values[i]);
+      else if(is_array)
+        r = JS_SetPropertyUint32(ctx, argv[1], i, values[i]);
+      else
+        r = JS_SetProperty(ctx, argv[1], set->names[i], values[i]);
+    }
+
+    ret = r < 0 ? JS_EXCEPTION : JS_DupValue(ctx, argv[1]);
+  } else {
+    ret = js_values_toarray(ctx, set->noutputs, values);
+    js_values_free(JS_GetRuntime(ctx), set->noutputs, values);
+  }
+
+  js_free(ctx, values);
+  return ret;
+}
+
+static JSValue
+js_pointer_set_get(JSContext* ctx, JSValueConst this_val, int magic) {
+  PointerSet* set;
+  JSValue ret = JS_UNDEFINED;
+  uint32_t i;
+
+  if(!(set = JS_GetOpaque2(ctx, this_val, js_pointer_set_class_id)))
+    return JS_EXCEPTION;
+
+  switch(magic) {
+    case PROP_LENGTH: {
+      ret = JS_NewUint32(ctx, set->noutputs);
+      break;
+    }
+
+    case PROP_PATH: {
+      ret = JS_NewArray(ctx);
+
+      for(i = 0; i < set->noutputs; i++) JS_SetPropertyUint32(ctx, ret, i, JS_AtomToString(ctx, set->names[i]));
+      break;
+    }
+  }
+  return ret;
+}
+
 static JSValue
 js_pointer_funcs(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv, int magic) {
   JSValue ret;
@@ -213,10 +353,14 @@ js_pointer_funcs(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst*
       ret = js_pointer_wrap(ctx, ptr);
       for(i = 0; i < argc; i++) {
         JSAtom atom = JS_ValueToAtom(ctx, argv[i]);
-        pointer_push(ptr, atom);
+        pointer_push(ptr, ctx, atom);
       }
       break;
     }
+
+    case STATIC_COMPILE_SET: {
+      return js_pointer_set_new(ctx, argv[0]);
+    }
   }
   return ret;
 }
@@ -229,8 +373,11 @@ js_pointer_finalizer(JSRuntime* rt, JSValue val) {
     if(ptr->atoms) {
       uint32_t i;
       for(i = 0; i < ptr->n; i++) JS_FreeAtomRT(rt, ptr->atoms[i]);
-      js_free_rt(rt, ptr->atoms);
+      if(ptr->atoms != ptr->inline_atoms)
+        js_free_rt(rt, ptr->atoms);
     }
+    if(ptr->slots)
+      js_free_rt(rt, ptr->slots);
     js_free_rt(rt, ptr);
   }
   // JS_FreeValueRT(rt, val);
@@ -241,6 +388,69 @@ static JSClassDef js_pointer_class = {
     .finalizer = js_pointer_finalizer,
 };
 
+static void
+js_pointer_set_finalizer(JSRuntime* rt, JSValue val) {
+  PointerSet* set;
+
+  if((set = JS_GetOpaque(val, js_pointer_set_class_id))) {
+    pointer_set_free(set, rt);
+    js_free_rt(rt, set);
+  }
+}
+
+static JSClassDef js_pointer_set_class = {
+    .class_name = "PointerSet",
+    .finalizer = js_pointer_set_finalizer,
+};
+
+static JSValue
+js_pointer_cache_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv) {
+  PointerCache* pc;
+
+  if(!(pc = JS_GetOpaque2(ctx, this_val, js_pointer_cache_class_id)))
+    return JS_EXCEPTION;
+
+  pointer_cache_clear(pc, JS_GetRuntime(ctx));
+  return JS_UNDEFINED;
+}
+
+static JSValue
+js_pointer_cache_get(JSContext* ctx, JSValueConst this_val) {
+  PointerCache* pc;
+
+  if(!(pc = JS_GetOpaque2(ctx, this_val, js_pointer_cache_class_id)))
+    return JS_EXCEPTION;
+
+  return JS_NewUint32(ctx, pointer_cache_size(pc));
+}
+
+/* the parse cache holds atoms, release them along with the context */
+static void
+js_pointer_cache_finalizer(JSRuntime* rt, JSValue val) {
+  PointerCache* pc;
+
+  if((pc = JS_GetOpaque(val, js_pointer_cache_class_id)))
+    pointer_cache_free(pc, rt);
+}
+
+static JSClassDef js_pointer_cache_class = {
+    .class_name = "PointerCache",
+    .finalizer = js_pointer_cache_finalizer,
+};
+
+static const JSCFunctionListEntry js_pointer_cache_funcs[] = {
+    JS_CFUNC_DEF("clear", 0, js_pointer_cache_method),
+    JS_CGETSET_DEF("size", js_pointer_cache_get, 0),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "PointerCache", JS_PROP_CONFIGURABLE),
+};
+
+static const JSCFunctionListEntry js_pointer_set_proto_funcs[] = {
+    JS_CFUNC_DEF("extract", 1, js_pointer_set_extract),
+    JS_CGETSET_MAGIC_DEF("length", js_pointer_set_get, 0, PROP_LENGTH),
+    JS_CGETSET_MAGIC_DEF("pointers", js_pointer_set_get, 0, PROP_PATH),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "PointerSet", JS_PROP_C_W_E),
+};
+
 static const JSCFunctionListEntry js_pointer_proto_funcs[] = {
     JS_CFUNC_MAGIC_DEF("deref", 1, js_pointer_method, METHOD_DEREF),
     JS_CFUNC_MAGIC_DEF("toString", 0, js_pointer_method, METHOD_TO_STRING),
@@ -259,11 +469,14 @@ static const JSCFunctionListEntry js_pointer_proto_funcs[] = {
 static const JSCFunctionListEntry js_pointer_static_funcs[] = {
     JS_CFUNC_MAGIC_DEF("from", 1, js_pointer_funcs, STATIC_FROM),
     JS_CFUNC_MAGIC_DEF("of", 0, js_pointer_funcs, STATIC_OF),
+    JS_CFUNC_MAGIC_DEF("compileSet", 1, js_pointer_funcs, STATIC_COMPILE_SET),
 };
 
 static int
 js_pointer_init(JSContext* ctx, JSModuleDef* m) {
   JSAtom inspectAtom;
+  JSValue cache;
+
   JS_NewClassID(&js_pointer_class_id);
   JS_NewClass(JS_GetRuntime(ctx), js_pointer_class_id, &js_pointer_class);
 
@@ -277,11 +490,28 @@ js_pointer_init(JSContext* ctx, JSModuleDef* m) {
 
   JS_SetClassProto(ctx, js_pointer_class_id, pointer_proto);
 
+  JS_NewClassID(&js_pointer_set_class_id);
+  JS_NewClass(JS_GetRuntime(ctx), js_pointer_set_class_id, &js_pointer_set_class);
+
+  pointer_set_proto = JS_NewObject(ctx);
+  JS_SetPropertyFunctionList(ctx, pointer_set_proto, js_pointer_set_proto_funcs, countof(js_pointer_set_proto_funcs));
+  JS_SetClassProto(ctx, js_pointer_set_class_id, pointer_set_proto);
+
   pointer_ctor = JS_NewCFunction2(ctx, js_pointer_constructor, "Pointer", 1, JS_CFUNC_constructor, 0);
 
   JS_SetConstructor(ctx, pointer_ctor, pointer_proto);
   JS_SetPropertyFunctionList(ctx, pointer_ctor, js_pointer_static_funcs, countof(js_pointer_static_funcs));
 
+  JS_NewClassID(&js_pointer_cache_class_id);
+  JS_NewClass(JS_GetRuntime(ctx), js_pointer_cache_class_id, &js_pointer_cache_class);
+
+  /* one cache per context, pointer_fromstring() finds it as the prototype of the PointerCache class */
+  cache = JS_NewObjectClass(ctx, js_pointer_cache_class_id);
+  JS_SetOpaque(cache, pointer_cache_new(ctx));
+  JS_SetPropertyFunctionList(ctx, cache, js_pointer_cache_funcs, countof(js_pointer_cache_funcs));
+  JS_SetClassProto(ctx, js_pointer_cache_class_id, JS_DupValue(ctx, cache));
+  JS_DefinePropertyValueStr(ctx, pointer_ctor, "cache", cache, JS_PROP_CONFIGURABLE);
+
   if(m) {
     JS_SetModuleExport(ctx, m, "Pointer", pointer_ctor);
   }
@@ -8,9 +8,9 @@
 VISIBLE JSClassID js_predicate_class_id = 0;
 static JSValue predicate_proto, predicate_ctor;
 
-enum { METHOD_EVAL = 0, METHOD_TOSTRING };
+enum { METHOD_EVAL = 0, METHOD_TOSTRING, METHOD_COMPILE, METHOD_FILTER, METHOD_TEST, METHOD_COUNT };
 
-enum { PROP_ID = 0, PROP_VALUES };
+enum { PROP_ID = 0, PROP_VALUES, PROP_PROGRAM };
 
 VISIBLE Predicate*
 js_predicate_data(JSContext* ctx, JSValueConst value) {
@@ -169,6 +169,41 @@ fail:
   return JS_EXCEPTION;
 }
 
+/* copies the elements of a typed array selected by 'mask' */
+static JSValue
+js_predicate_filter(JSContext* ctx, JSValueConst array, const uint8_t* mask, uint32_t len, int64_t count) {
+  JSObject* p = JS_VALUE_GET_OBJ(array);
+  JSValue ret;
+  uint32_t i, j;
+
+  if(p->class_id >= JS_CLASS_UINT8C_ARRAY && p->class_id <= JS_CLASS_FLOAT64_ARRAY) {
+    size_t offset, length, size;
+    const char* name;
+    uint8_t* data;
+
+    JS_FreeValue(ctx, JS_GetTypedArrayBuffer(ctx, array, &offset, &length, &size));
+
+    if(!(data = js_malloc(ctx, count * size + 1)))
+      return JS_EXCEPTION;
+
+    /* the predicate may have shrunk the array */
+    len = min_uint32(len, p->u.array.count);
+
+    for(i = 0, j = 0; i < len; i++)
+      if(mask[i])
+        memcpy(data + (j++) * size, (const uint8_t*)p->u.array.u.ptr + i * size, size);
+
+    name = JS_AtomToCString(ctx, JS_GetRuntime(ctx)->class_array[p->class_id].class_name);
+    ret = js_typedarray_new(ctx, name, data, j * size);
+    JS_FreeCString(ctx, name);
+    js_free(ctx, data);
+    return ret;
+  }
+
+  /* arrays are filtered by predicate_batch(), which keeps the values it tested */
+  return JS_ThrowTypeError(ctx, "argument must be a typed array");
+}
+
 static JSValue
 js_predicate_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv, int magic) {
   Predicate* pred;
@@ -186,6 +221,55 @@ js_predicate_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueCons
       //  printf("predicate_eval() = %i\n", r);
       break;
     }
+
+    case METHOD_COMPILE: {
+      PredicateProgram* prog;
+
+      if(!(prog = predicate_compile(this_val, ctx)))
+        return JS_EXCEPTION;
+
+      if(pred->program)
+        predicate_program_free(pred->program, JS_GetRuntime(ctx));
+
+      pred->program = prog;
+      ret = JS_DupValue(ctx, this_val);
+      break;
+    }
+
+    case METHOD_FILTER:
+    case METHOD_TEST:
+    case METHOD_COUNT: {
+      uint8_t* mask;
+      uint32_t len;
+      int64_t count;
+      JSValue matches = JS_UNDEFINED;
+
+      /* compile combinators before running them over many values, kept apart from the program of compile() */
+      if(!pred->program && !pred->batch && pred->id >= PREDICATE_NOTNOT && pred->id <= PREDICATE_XOR)
+        if(!(pred->batch = predicate_compile(this_val, ctx)))
+          return JS_EXCEPTION;
+
+      /* filter() returns the values which were tested, reading them again could give different ones */
+      if(magic == METHOD_FILTER && !js_is_typedarray(ctx, argv[0]))
+        matches = JS_NewArray(ctx);
+
+      if((count = predicate_batch(pred, ctx, argv[0], &mask, &len, matches)) < 0) {
+        JS_FreeValue(ctx, matches);
+        return JS_EXCEPTION;
+      }
+
+      if(magic == METHOD_COUNT)
+        ret = JS_NewInt64(ctx, count);
+      else if(magic == METHOD_TEST)
+        ret = js_typedarray_new(ctx, "Uint8Array", mask, len);
+      else if(JS_IsObject(matches))
+        ret = matches;
+      else
+        ret = js_predicate_filter(ctx, argv[0], mask, len, count);
+
+      js_free(ctx, mask);
+      break;
+    }
   }
   return ret;
 }
@@ -223,6 +307,19 @@ js_predicate_get(JSContext* ctx, JSValueConst this_val, int magic) {
       ret = predicate_values(pred, ctx);
       break;
     }
+
+    case PROP_PROGRAM: {
+      DynBuf dbuf;
+
+      if(!pred->program)
+        break;
+
+      js_dbuf_init(ctx, &dbuf);
+      predicate_program_dump(pred->program, ctx, &dbuf);
+      ret = JS_NewStringLen(ctx, (const char*)dbuf.buf, dbuf.size);
+      dbuf_free(&dbuf);
+      break;
+    }
   }
   return ret;
 }
@@ -357,9 +454,14 @@ static JSClassDef js_predicate_class = {.class_name = "Predicate",
 static const JSCFunctionListEntry js_predicate_proto_funcs[] = {
     JS_CFUNC_MAGIC_DEF("eval", 1, js_predicate_method, METHOD_EVAL),
     JS_CFUNC_DEF("toString", 0, js_predicate_tostring),
+    JS_CFUNC_MAGIC_DEF("compile", 0, js_predicate_method, METHOD_COMPILE),
+    JS_CFUNC_MAGIC_DEF("filter", 1, js_predicate_method, METHOD_FILTER),
+    JS_CFUNC_MAGIC_DEF("test", 1, js_predicate_method, METHOD_TEST),
+    JS_CFUNC_MAGIC_DEF("count", 1, js_predicate_method, METHOD_COUNT),
     JS_ALIAS_DEF("call", "eval"),
     JS_CGETSET_MAGIC_DEF("id", js_predicate_get, 0, PROP_ID),
     JS_CGETSET_MAGIC_DEF("values", js_predicate_get, 0, PROP_VALUES),
+    JS_CGETSET_MAGIC_DEF("program", js_predicate_get, 0, PROP_PROGRAM),
     JS_PROP_STRING_DEF("[Symbol.toStringTag]", "Predicate", JS_PROP_C_W_E),
 };
 
@@ -6,6 +6,7 @@
 #include "libregexp.h"
 #include "property-enumeration.h"
 #include "quickjs.h"
+#include "quickjs-predicate.h"
 #include <string.h>
 
 VISIBLE JSClassID js_tree_walker_class_id;
@@ -46,12 +47,122 @@ typedef struct {
   Vector frames;
   uint32_t tag_mask;
   uint32_t ref_count;
+  BOOL cached;
+  enum value_mask type;
+  JSValue value; /* the current node, fetched once per position */
 } TreeWalker;
 
+static void
+tree_walker_uncache(TreeWalker* w, JSRuntime* rt) {
+  if(w->cached) {
+    JS_FreeValueRT(rt, w->value);
+    w->value = JS_UNDEFINED;
+    w->cached = FALSE;
+  }
+}
+
+/* returns the value at the current position, without a reference */
+static JSValueConst
+tree_walker_value(TreeWalker* w, JSContext* ctx) {
+  PropertyEnumeration* it;
+
+  if(!w->cached) {
+    if(vector_empty(&w->frames))
+      return JS_UNDEFINED;
+
+    it = vector_back(&w->frames, sizeof(PropertyEnumeration));
+
+    if(it->idx >= it->tab_atom_len)
+      return JS_UNDEFINED;
+
+    w->value = property_enumeration_value(it, ctx);
+
+    if(JS_IsException(w->value))
+      return JS_EXCEPTION;
+
+    w->type = js_value_type(ctx, w->value);
+    w->cached = TRUE;
+  }
+
+  return w->value;
+}
+
+/* like property_enumeration_recurse(), but descends using the cached value */
+static PropertyEnumeration*
+tree_walker_step(TreeWalker* w, JSContext* ctx) {
+  PropertyEnumeration* it;
+
+  if(vector_empty(&w->frames))
+    return 0;
+
+  it = vector_back(&w->frames, sizeof(PropertyEnumeration));
+
+  if(it->tab_atom_len > 0) {
+    JSValueConst value = tree_walker_value(w, ctx);
+
+    if(JS_IsObject(value) && !property_enumeration_circular(&w->frames, value)) {
+      JSValue obj = JS_DupValue(ctx, value);
+
+      tree_walker_uncache(w, JS_GetRuntime(ctx));
+
+      if((it = property_enumeration_push(&w->frames, ctx, obj, PROPENUM_DEFAULT_FLAGS)) &&
+         property_enumeration_setpos(it, 0))
+        return it;
+    } else {
+      tree_walker_uncache(w, JS_GetRuntime(ctx));
+
+      if(property_enumeration_setpos(it, it->idx + 1))
+        return it;
+    }
+  }
+
+  for(;;) {
+    if((it = property_enumeration_pop(&w->frames, ctx)) == 0)
+      return it;
+    if(property_enumeration_setpos(it, it->idx + 1))
+      break;
+  }
+  return it;
+}
+
+/* Predicate objects are evaluated natively, functions are called with (value, key, this_arg) */
+static BOOL
+tree_walker_filter(TreeWalker* w, JSContext* ctx, PropertyEnumeration* it, JSValueConst pred, JSValueConst this_arg) {
+  Predicate* pr;
+  JSValue args[3];
+  int result;
+
+  if(!(pr = js_predicate_data(ctx, pred)) && !JS_IsFunction(ctx, pred))
+    return TRUE;
+
+  /* w->value is borrowed, the filter may move the walker and free it */
+  args[0] = JS_DupValue(ctx, tree_walker_value(w, ctx));
+  args[1] = property_enumeration_key(it, ctx);
+  args[2] = this_arg;
+
+  if(pr) {
+    result = predicate_eval(pr, ctx, 2, args);
+  } else {
+    JSValue ret = JS_Call(ctx, pred, JS_UNDEFINED, 3, args);
+
+    result = JS_IsException(ret) ? -1 : JS_ToBool(ctx, ret);
+    JS_FreeValue(ctx, ret);
+  }
+
+  if(result < 0)
+    JS_FreeValue(ctx, JS_GetException(ctx));
+
+  JS_FreeValue(ctx, args[0]);
+  JS_FreeValue(ctx, args[1]);
+  return result > 0;
+}
+
 static void
 tree_walker_reset(TreeWalker* w, JSContext* ctx) {
   PropertyEnumeration* it;
 
+  tree_walker_uncache(w, JS_GetRuntime(ctx));
+
   vector_foreach_t(&w->frames, it) { property_enumeration_reset(it, JS_GetRuntime(ctx)); }
   vector_clear(&w->frames);
 
@@ -129,22 +240,16 @@ js_tree_walker_tostring(JSContext* ctx, JSValueConst this_val, int argc, JSValue
 static PropertyEnumeration*
 js_tree_walker_next(JSContext* ctx, TreeWalker* w, JSValueConst this_arg, JSValueConst pred) {
   PropertyEnumeration* it;
-  enum value_mask type, mask = w->tag_mask & TYPE_ALL;
+  enum value_mask mask = w->tag_mask & TYPE_ALL;
 
-  for(; (it = property_enumeration_recurse(&w->frames, ctx));) {
+  for(; (it = tree_walker_step(w, ctx));) {
     if(mask && mask != TYPE_ALL) {
-      JSValue value;
-      value = property_enumeration_value(it, ctx);
-      type = js_value_type(ctx, value);
-      JS_FreeValue(ctx, value);
-      if((mask & type) == 0)
-        continue;
-    }
-    if(JS_IsFunction(ctx, pred)) {
-      BOOL result = property_enumeration_predicate(it, ctx, pred, this_arg);
-      if(!result)
+      tree_walker_value(w, ctx);
+      if(!w->cached || (mask & w->type) == 0)
         continue;
     }
+    if(!JS_IsUndefined(pred) && !tree_walker_filter(w, ctx, it, pred, this_arg))
+      continue;
     break;
   }
   return it;
@@ -163,6 +268,9 @@ js_tree_walker_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueCo
 
   it = vector_back(&w->frames, sizeof(PropertyEnumeration));
 
+  if(magic != NEXT_NODE)
+    tree_walker_uncache(w, JS_GetRuntime(ctx));
+
   if(magic == PREVIOUS_NODE) {
     magic = it->idx == 0 ? PARENT_NODE : PREVIOUS_SIBLING;
   }
@@ -204,7 +312,7 @@ js_tree_walker_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueCo
       break;
     }
   }
-  return it ? property_enumeration_value(it, ctx) : JS_UNDEFINED;
+  return it ? JS_DupValue(ctx, tree_walker_value(w, ctx)) : JS_UNDEFINED;
 }
 
 static JSValue
@@ -228,7 +336,7 @@ js_tree_walker_get(JSContext* ctx, JSValueConst this_val, int magic) {
 
     case PROP_CURRENT_NODE: {
       if(it)
-        return property_enumeration_value(it, ctx);
+        return JS_DupValue(ctx, tree_walker_value(w, ctx));
       break;
     }
 
@@ -278,6 +386,7 @@ js_tree_walker_set(JSContext* ctx, JSValueConst this_val, JSValueConst value, in
       if(index < 0)
         index = (index % property_enumeration_length(it)) + property_enumeration_length(it);
       it->idx = index;
+      tree_walker_uncache(w, JS_GetRuntime(ctx));
       break;
     }
 
@@ -315,6 +424,7 @@ js_tree_walker_finalizer(JSRuntime* rt, JSValue val) {
     PropertyEnumeration *s, *e;
 
     if(--w->ref_count == 0) {
+      tree_walker_uncache(w, rt);
       for(s = vector_begin(&w->frames), e = vector_end(&w->frames); s != e; s++) { property_enumeration_reset(s, rt); }
       vector_free(&w->frames);
       js_free_rt(rt, w);
@@ -385,12 +495,12 @@ js_tree_iterator_next(JSContext* ctx, JSValueConst this_val, int argc, JSValueCo
        }*/
 
       switch(r) {
-        case RETURN_VALUE: ret = property_enumeration_value(it, ctx); break;
+        case RETURN_VALUE: ret = JS_DupValue(ctx, tree_walker_value(w, ctx)); break;
         case RETURN_PATH: ret = property_enumeration_path(&w->frames, ctx); break;
         case RETURN_VALUE_PATH:
         default: {
           ret = JS_NewArray(ctx);
-          JS_SetPropertyUint32(ctx, ret, 0, property_enumeration_value(it, ctx));
+          JS_SetPropertyUint32(ctx, ret, 0, JS_DupValue(ctx, tree_walker_value(w, ctx)));
           JS_SetPropertyUint32(ctx, ret, 1, property_enumeration_path(&w->frames, ctx));
           break;
         }
@@ -413,6 +523,7 @@ js_tree_iterator_finalizer(JSRuntime* rt, JSValue val) {
     PropertyEnumeration *s, *e;
 
     if(--w->ref_count == 0) {
+      tree_walker_uncache(w, rt);
       for(s = vector_begin(&w->frames), e = vector_end(&w->frames); s != e; s++) { property_enumeration_reset(s, rt); }
       vector_free(&w->frames);
       js_free_rt(rt, w);
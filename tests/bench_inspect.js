@@ -0,0 +1,118 @@
+import * as os from 'os';
+import * as std from 'std';
+import inspect from 'inspect';
+
+('use strict');
+
+/* run with qjsm --count-allocs (see the bench_inspect target), it provides getMemoryUsage() */
+const memoryUsage = globalThis.getMemoryUsage ?? (() => ({ allocatedSize: NaN, allocatedCount: NaN }));
+
+const MIN_TIME = 250; /* ms per measurement */
+
+/* number of values inspect() visits in 'value' */
+function countNodes(value, seen = new Set()) {
+  if(typeof value != 'object' || value === null) return 1;
+  if(seen.has(value)) return 1;
+  seen.add(value);
+
+  let n = 1;
+
+  if(ArrayBuffer.isView(value)) return n + value.length;
+  if(value instanceof Map) {
+    for(let [k, v] of value) n += countNodes(k, seen) + countNodes(v, seen);
+    return n;
+  }
+  if(value instanceof Set) {
+    for(let v of value) n += countNodes(v, seen);
+    return n;
+  }
+  for(let key in value) n += countNodes(value[key], seen);
+  return n;
+}
+
+/* calls fn() repeatedly for at least MIN_TIME ms, returns ns per call */
+function measure(fn) {
+  let calls = 0,
+    start = Date.now(),
+    elapsed;
+
+  do {
+    for(let i = 0; i < 10; i++) fn();
+    calls += 10;
+  } while((elapsed = Date.now() - start) < MIN_TIME);
+
+  return (elapsed * 1e6) / calls;
+}
+
+/* bytes and blocks allocated during one call, including what was freed again before it returned */
+function allocation(fn) {
+  std.gc();
+  let before = memoryUsage();
+  let result = fn();
+  let after = memoryUsage();
+  return [after.allocatedSize - before.allocatedSize, after.allocatedCount - before.allocatedCount, result];
+}
+
+function makeDeep(levels) {
+  let obj = { leaf: true };
+  for(let i = 0; i < levels; i++) obj = { level: i, child: obj };
+  return obj;
+}
+
+const fixtures = {
+  wide: Object.fromEntries([...Array(1000).keys()].map(i => ['key' + i, i])),
+  deep: makeDeep(100),
+  'long array': [...Array(10000).keys()].map(i => i * 1.5),
+  'array of objects': [...Array(1000).keys()].map(i => ({ id: i, name: 'item' + i, tags: ['a', 'b'] })),
+  'typed array': new Float64Array(10000).map((n, i) => i / 3),
+  map: new Map([...Array(2000).keys()].map(i => ['key' + i, { hits: i }])),
+  'escaped strings': [...Array(1000).keys()].map(i => `line ${i}\n\t"quoted" 'single' \\ é中`)
+};
+
+const variants = {
+  plain: { colors: false },
+  colored: { colors: true },
+  compact: { colors: false, compact: Infinity, breakLength: Infinity },
+  json: { format: 'json' }
+};
+
+/* console.log() streams objects to its file with inspect.write(), this measures that path without the terminal */
+const devNull = os.open('/dev/null', os.O_WRONLY);
+
+function row(...cols) {
+  std.puts(cols.map((col, i) => (i ? String(col).padStart(12) : String(col).padEnd(28))).join('') + '\n');
+}
+
+function main() {
+  row('case', 'ns/call', 'ns/node', 'bytes out', 'bytes alloc', 'allocs', 'vs JSON');
+
+  for(let [name, value] of Object.entries(fixtures)) {
+    let nodes = countNodes(value);
+    let json = measure(() => JSON.stringify(value));
+
+    for(let [variant, opts] of Object.entries(variants)) {
+      let options = inspect.compileOptions({ depth: Infinity, maxArrayLength: Infinity, ...opts });
+      let fn = () => inspect(value, options);
+      let ns = measure(fn);
+      let [allocated, allocs, output] = allocation(fn);
+
+      row(`${name} (${variant})`,
+        ns.toFixed(0),
+        (ns / nodes).toFixed(1),
+        output.length,
+        allocated,
+        allocs,
+        (ns / json).toFixed(2) + 'x'
+      );
+    }
+
+    let options = inspect.compileOptions({ depth: Infinity, maxArrayLength: Infinity, colors: false });
+    let ns = measure(() => inspect.write(devNull, value, options));
+    row(`${name} (console)`, ns.toFixed(0), (ns / nodes).toFixed(1), inspect.write(devNull, value, options), '', '', (ns / json).toFixed(2) + 'x');
+
+    row(`${name} (JSON.stringify)`, json.toFixed(0), (json / nodes).toFixed(1), JSON.stringify(value).length, '', '', '1.00x');
+  }
+}
+
+main();
+os.close(devNull);
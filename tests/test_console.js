@@ -31,6 +31,11 @@ function main(...args) {
 
   console.log('testObject:', testObject);
 
+  console.options.depth = 0;
+  console.log('testObject (depth: 0):', testObject);
+  console.options = { ...console.options, depth: 2, colors: false };
+  console.log('testObject (depth: 2, colors: false):', testObject);
+
   std.gc();
 }
 
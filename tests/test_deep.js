@@ -101,6 +101,82 @@ function main(...args) {
   console.log('select():',
     deep.select(obj3, Predicate.property('name', Predicate.equal('x')), deep.RETURN_PATH_VALUE)
   );
+  let obj4 = { z: [NaN, true, false, Infinity, null], y: [undefined, 1.0, 1234n], x: { a: 2, name: 'x' }, w: 3, v: 4, 0: true };
+  console.log('equals():', deep.equals(obj3, obj4), deep.equals(obj3, obj2));
+  console.log('hash():', deep.hash(obj3) == deep.hash(obj4), deep.hash(obj3) != deep.hash(obj2));
+  let tagged = Object.assign([1, 2], { tag: 'x' });
+  console.log('equals() array props:', deep.equals(tagged, [1, 2]), deep.equals(tagged, Object.assign([1, 2], { tag: 'x' })));
+  console.log('hash() array props:', deep.hash(tagged) != deep.hash([1, 2]));
+  console.log('equals() internal state:', deep.equals(new Date(0), new Date(1)), deep.equals(new Map([[1, 2]]), new Map([[1, 3]])), deep.equals(new Set([1]), new Set([1])));
+  console.log('hash() internal state:', deep.hash(new Date(0)) != deep.hash(new Date(1)), deep.hash(new Set([1])) != deep.hash(new Set([2])));
+  let loop1 = {},
+    loop2 = { next: {} };
+  loop1.next = loop1;
+  loop2.next.next = loop2;
+  console.log('equals() cycles:', deep.equals(loop1, loop2), deep.hash(loop1) != deep.hash(loop2));
+  let throwing = { get x() { throw new Error('getter'); } };
+  try {
+    deep.equals(throwing, { x: 1 });
+    console.log('equals() getter exception: not thrown');
+  } catch(e) {
+    console.log('equals() getter exception:', e.message);
+  }
+  let edits = deep.diff(obj3, obj2);
+  console.log('diff():', edits);
+  console.log('patch():', deep.equals(deep.patch(deep.clone(obj3), edits), obj2));
+  console.log('diff() internal state:', deep.diff({ d: new Date(0) }, { d: new Date(1) }).length == 1, deep.diff(new Map([[1, 2]]), new Map([[1, 3]]))[0][1] == 'replace');
+  try {
+    deep.patch({ a: 1 }, [[42, 'replace', 2]]);
+    console.log('patch() bad path: not thrown');
+  } catch(e) {
+    console.log('patch() bad path:', e instanceof TypeError);
+  }
+  let buf = new ArrayBuffer(8);
+  let shared = { buf, u8: new Uint8Array(buf, 4), map: new Map([['k', obj4]]), set: new Set([obj4]) };
+  shared.self = shared;
+  let copy = deep.clone(shared, { transfer: [buf] });
+  let columns = deep.flattenColumns(obj3);
+  console.log('flattenColumns():', columns);
+  console.log('flattenColumns() type:', [...columns.type].map(t => 1 << t == deep.TYPE_OBJECT));
+  try {
+    deep.flattenColumns({ get x() {
+        throw new Error('getter');
+      } });
+    console.log('flattenColumns() getter exception: not thrown');
+  } catch(e) {
+    console.log('flattenColumns() getter exception:', e.message);
+  }
+  deep
+    .forEachAsync(obj3, (n, p) => console.log('deep.forEachAsync', { n, p }), null, deep.TYPE_ALL, { budgetMs: 1 })
+    .then(() => console.log('deep.forEachAsync done'));
+  console.log('clone():', copy.self === copy, copy.map.get('k') === [...copy.set][0], copy.u8.buffer === copy.buf, copy.u8.length == 4, buf.byteLength);
+  let sparse = Object.assign([1, 2], { tag: 'x' });
+  sparse.length = 5;
+  let sparseCopy = deep.clone(sparse);
+  console.log('clone() array:', sparseCopy.tag === 'x', sparseCopy.length == 5, deep.clone(new Array(3)).length == 3);
+  class Point {
+    constructor(x) {
+      this.x = x;
+    }
+  }
+  let date = Object.assign(new Date(0), { tag: 'd' });
+  let error = deep.clone(new RangeError('bad'));
+  console.log('clone() classes:', deep.clone(new Point(1)) instanceof Point, error instanceof RangeError, error.message === 'bad', deep.clone(date).tag === 'd');
+  try {
+    deep.clone(new WeakMap());
+    console.log('clone() WeakMap: not thrown');
+  } catch(e) {
+    console.log('clone() WeakMap:', e instanceof TypeError);
+  }
+  try {
+    deep.clone({}, { maxDepth: 0 });
+    console.log('clone() maxDepth 0: not thrown');
+  } catch(e) {
+    console.log('clone() maxDepth 0:', e instanceof RangeError);
+  }
+  let unreachable = new ArrayBuffer(4);
+  deep.clone({}, { transfer: [unreachable] });
+  console.log('clone() transfer unreachable:', unreachable.byteLength == 0);
   return;
 
   for(let o of [obj1, obj2]) {
@@ -127,12 +127,50 @@ async function main(...args) {
   };
 
   console.log('inspect(deepObj)', inspect(deepObj, options));
+  console.log('inspect(deepObj, { compact: 3 })', inspect(deepObj, { ...options, compact: 3 }));
+  let wideObj = Object.fromEntries([...Array(20).keys()].map(i => ['property' + i, i]));
+  console.log('inspect(wideObj, { compact: 5 }) breaks lines', inspect(wideObj, { colors: false, compact: 5, breakLength: 80 }).includes('\n'));
+
+  let floats = new Float32Array(65536).map((n, i) => i / 4);
+  console.log('inspect(floats)', inspect(floats, { ...options, maxArrayLength: 8 }));
+  console.log('inspect(floats.buffer)', inspect(floats.buffer, { ...options, maxArrayLength: 64 }));
+  console.log('inspect(Int16Array)', inspect(Int16Array.of(-1, 2, -3), options));
+  std.out.flush();
+  let written = inspect.write(1, deepObj, { ...options, colors: false });
+  console.log('\ninspect.write:', written);
+  let compiled = inspect.compileOptions({ ...options, depth: 1, hideKeys: ['x'] });
+  console.log('compiled.toObject()', compiled.toObject());
+  console.log('inspect(deepObj, compiled)', inspect(deepObj, compiled));
+  let json = inspect({ a: 1, b: [NaN, undefined, 2n], m: new Map([['k', { deepObj }]]) }, { format: 'json', depth: 2 });
+  console.log('inspect(..., { format: \'json\' })', json, JSON.parse(json));
+
+  let rows = [...Array(1000).keys()].map(i => ({ id: i, 'a-b': i * 2, [Symbol.for('row')]: true, secret: 'x' }));
+  console.log('inspect(rows)', inspect(rows, { ...options, maxArrayLength: 3, hideKeys: ['secret'] }));
+
+  console.log('inspect(rows, { maxNodes: 20 })', inspect(rows, { ...options, maxArrayLength: Infinity, maxNodes: 20 }));
+  console.log('inspect(rows, { maxOutputBytes: 200 })', inspect(rows, { ...options, maxArrayLength: Infinity, maxOutputBytes: 200 }));
+  console.log('inspect({ [Symbol(\'"quoted"\')]: 1, date: new Date(0), error: new TypeError(\'bad\') }, { format: \'json\' })',
+    JSON.parse(inspect({ [Symbol('"quoted"')]: 1, date: new Date(0), error: new TypeError('bad') }, { format: 'json' }))
+  );
+  console.log('inspect(rows, { format: \'json\', maxNodes: 10 })', JSON.parse(inspect(rows, { format: 'json', maxNodes: 10 })));
+  let bytes = new Uint8Array(4096).map((n, i) => i);
+  console.log('inspect(bytes, { maxNodes: 20 })', inspect(bytes, { ...options, maxArrayLength: Infinity, maxNodes: 20 }));
+  console.log('inspect(bytes.buffer, { maxOutputBytes: 200 })', inspect(bytes.buffer, { ...options, maxArrayLength: Infinity, maxOutputBytes: 200 }).length < 400);
+  console.log('inspect(bytes.buffer, { format: \'json\', maxOutputBytes: 200 })', JSON.parse(inspect(bytes.buffer, { format: 'json', maxArrayLength: Infinity, maxOutputBytes: 200 })));
 
   let s = new Set();
   ['a', 'b', 'c', 'd', 1, 2, 3, 4].forEach(item => s.add(item));
 
   console.log('inspect(s)', inspect(s, options));
 
+  let cache = new Map([...Array(10000).keys()].map(i => ['key' + i, { hits: i }]));
+  console.log('inspect(cache)', inspect(cache, { ...options, maxArrayLength: 4 }));
+  console.log('inspect(s, { maxArrayLength: 2 })', inspect(s, { ...options, maxArrayLength: 2 }));
+  let cursor = inspect.cursor({ rows, cache, s }, { ...options, maxArrayLength: 4 });
+  console.log('cursor.read(10)', cursor.read(10));
+  console.log('cursor.next()', cursor.next());
+  console.log('remaining lines', [...cursor].length, cursor.done);
+
   //for(let item of s) console.log('item:', item);
 
   std.gc();
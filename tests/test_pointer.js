@@ -43,6 +43,31 @@ function main(...args) {
   console.log('pointer:', pointer);
   console.log('pointer.toString()):', pointer.toString());
   console.log('pointer.toArray()):', pointer.toArray());
+
+  let records = [...Array(100).keys()].map(i => ({ id: i, tags: ['a', 'b'], meta: { size: i * 2 } }));
+  let sizePtr = new Pointer('meta.size');
+  console.log('sizes:', records.map(r => sizePtr.deref(r)).slice(0, 5));
+  try {
+    new Pointer('meta.missing').deref(records[0]);
+  } catch(e) {
+    console.log('exception:', e.message);
+  }
+
+  let set = Pointer.compileSet(['id', 'meta.size', new Pointer(['tags', 1])]);
+  console.log('set.pointers:', set.pointers);
+  console.log('set.extract():', set.extract(records[3]));
+  console.log('set.extract(target):', set.extract(records[4], {}));
+  try {
+    set.extract(records[4], Object.freeze([]));
+    console.log('set.extract(frozen): not thrown');
+  } catch(e) {
+    console.log('set.extract(frozen):', e instanceof TypeError);
+  }
+
+  for(let i = 0; i < 1000; i++) new Pointer('a.b[3].c');
+  console.log('cached:', new Pointer('a.b[3].c').toArray(), 'Pointer.cache.size:', Pointer.cache.size);
+  Pointer.cache.clear();
+  console.log('Pointer.cache.size:', Pointer.cache.size);
   /*pointer = new Pointer([3, 'children', 0, 'children', 0]);
   try {
     console.log('deref pointer:', pointer.deref(result));
@@ -96,6 +96,39 @@ async function main(...args) {
 
   for(let ch of ['_', '2', 'A', 'a', '?', '-']) console.log(`isAlnum('${ch}') =`, isAlnum(ch));
 
+  let isSymbol = charset('0123456789\u00e4\u00f6\u00fc\u2605\u2606\u2607\u29bf');
+  for(let str of ['0815', '\u00e4\u2606', '\u2605\u29bf9', '\u2608', 'ab'])
+    console.log(`isSymbol('${str}') =`, isSymbol(str));
+
+  let startsWithStar = string('\u2605 ');
+  for(let str of ['\u2605 rated', '\u2606 rated', new Uint8Array([0xe2, 0x98, 0x85, 0x20, 0x78]).buffer, 'x'])
+    console.log(`startsWithStar(${inspect(str)}) =`, startsWithStar(str));
+
+  let ints = new Int32Array([1, 7, 3, 7, 7, 0]);
+  let eq7 = equal(7);
+  console.log('eq7.count(ints) =', eq7.count(ints));
+  console.log('eq7.test(ints) =', eq7.test(ints));
+  console.log('eq7.filter(ints) =', eq7.filter(ints));
+  let shadowed = Object.defineProperty(new Int32Array([7, 7, 1]), 'length', { value: 0 });
+  console.log('eq7.count(shadowed length) =', eq7.count(shadowed));
+  console.log('isAlpha.filter([...]) =', isAlpha.filter(['a', '1', 'B', '?', 'z']));
+  console.log('type(Predicate.TYPE_FLOAT64).count(floats) =', type(Predicate.TYPE_FLOAT64).count(new Float64Array([NaN, 1.5, NaN])));
+
+  class Point {
+    constructor(x, y) {
+      this.x = x;
+      this.y = y;
+    }
+  }
+  let points = [...Array(1000).keys()].map(i => (i % 3 ? new Point(i, -i) : { x: i }));
+  console.log('instanceOf(Point).count(points) =', instanceOf(Point).count(points));
+  console.log('prototypeIs(Point.prototype).count(points) =', prototypeIs(Point.prototype).count(points));
+  console.log(`property('y').count(points) =`, property('y').count(points));
+  console.log(`property('x', type(Predicate.TYPE_INT)).count(points) =`, property('x', type(Predicate.TYPE_INT)).count(points));
+
+  let captures = [];
+  console.log(`isIdentifier('\u00e4bc_1') =`, isIdentifier('\u00e4bc_1', captures), captures);
+
   let propToString = property('toString');
   let propTest = property('test');
 
@@ -107,6 +140,32 @@ async function main(...args) {
   console.log('propTest({})', propTest({}));
   console.log('propTest({test: undefined})', propTest({ test: undefined }));
 
+  let isWord = and(not(isDigit), or(isAlnum, property('length', equal(0))));
+  let results = ['_', '2', 'A', 'a', '?', ''].map(ch => isWord(ch));
+  console.log('isWord.compile() =', isWord.compile() === isWord);
+  console.log('isWord.program =\n' + isWord.program);
+  let isNumberOrString = or(type(Predicate.TYPE_INT), not(not(type(Predicate.TYPE_STRING))), or(isDigit, isDigit, type(Predicate.TYPE_FLOAT64)));
+  console.log('isNumberOrString.compile().program =\n' + isNumberOrString.compile().program);
+  console.log('isNumberOrString.filter([...]) =', isNumberOrString.filter([1, 'a', 1.5, null, {}, 2n]));
+  let calls = 0;
+  let counted = v => (calls++, true);
+  let isCountedInt = and(counted, type(Predicate.TYPE_INT), counted, not(counted));
+  console.log('isCountedInt.count([1, 2]) =', isCountedInt.count([1, 2]), 'calls =', calls);
+  console.log('isCountedInt.program after count() =', isCountedInt.program);
+  let getterCalls = 0;
+  let watched = { get x() {
+      getterCalls++;
+      return 1;
+    } };
+  let hasXAndInt = and(property('x', type(Predicate.TYPE_INT)), type(Predicate.TYPE_STRING));
+  console.log('hasXAndInt.count([watched]) =', hasXAndInt.count([watched]), 'getterCalls =', getterCalls);
+  let reads = 0;
+  let changing = Object.defineProperty([], 0, { get: () => reads++, enumerable: true });
+  console.log('type(TYPE_INT).filter(changing) =', type(Predicate.TYPE_INT).filter(changing), 'reads =', reads);
+  console.log('compiled results equal',
+    ['_', '2', 'A', 'a', '?', ''].every((ch, i) => isWord(ch) === results[i])
+  );
+
   /*
 
   for(let str of ['_ABC3', '1ABC', '_1ABC', 'A1B2C3'])
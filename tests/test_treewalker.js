@@ -3,6 +3,7 @@ import * as std from 'std';
 import inspect from 'inspect';
 import * as xml from 'xml';
 import { TreeWalker, TreeIterator } from 'tree_walker';
+import { Predicate } from 'predicate';
 import Console from '../lib/console.js';
 
 ('use strict');
@@ -41,6 +42,7 @@ function main(...args) {
   console.log('result:', result);
 
   TestIterator();
+  TestPredicate();
 
   //console.log('xml:\n' + xml.write(result));
   function TestWalker() {
@@ -89,6 +91,12 @@ function main(...args) {
       console.log(`pointer: ${pointer}, entry:`, entry);
     }
   }
+  function TestPredicate() {
+    let walk = new TreeWalker({ a: 'x', b: { c: 'y', d: 1 }, e: ['z'] });
+    let strings = [];
+    while(walk.nextNode(Predicate.type(Predicate.TYPE_STRING))) strings.push(walk.currentPath.join('.'));
+    console.log('strings:', strings);
+  }
   console.log('result', result);
   //console.log(result.slice(2));
 
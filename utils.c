@@ -845,6 +845,106 @@ js_get_propertystr_uint64(JSContext* ctx, JSValueConst obj, const char* prop) {
   return ret;
 }
 
+/* finds an own property like find_own_property() in quickjs.c, trying the slot hint first */
+JSShapeProperty*
+js_shape_find(JSObject* p, JSAtom atom, uint32_t* slot) {
+  JSShape* sh = p->shape;
+  JSShapeProperty* prs;
+  uint32_t h;
+
+  /* the atom check validates the hint, whatever shape the object has now */
+  if(slot && *slot < (uint32_t)sh->prop_count && sh->prop[*slot].atom == atom)
+    return &sh->prop[*slot];
+
+  h = atom & sh->prop_hash_mask;
+  h = ((uint32_t*)sh)[-(ptrdiff_t)h - 1];
+
+  while(h) {
+    prs = &sh->prop[h - 1];
+
+    if(prs->atom == atom) {
+      if(slot)
+        *slot = h - 1;
+      return prs;
+    }
+    h = prs->hash_next;
+  }
+  return 0;
+}
+
+/* resolves 'atom' on 'obj' and its prototypes without calling into JS.
+ * returns 1 and the holding object when found, 0 when not and -1 when there is an exotic object on the chain */
+int
+js_shape_lookup(JSValueConst obj, JSAtom atom, uint32_t* slot, JSObject** holder, JSShapeProperty** prsp) {
+  JSObject* p;
+
+  if(!JS_IsObject(obj) || js_atom_isint(atom))
+    return -1;
+
+  for(p = JS_VALUE_GET_OBJ(obj); p; p = p->shape->proto) {
+    /* arrays are exotic for indexes only */
+    if(p->is_exotic && p->class_id != JS_CLASS_ARRAY)
+      return -1;
+
+    if((*prsp = js_shape_find(p, atom, p == JS_VALUE_GET_OBJ(obj) ? slot : 0))) {
+      *holder = p;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* JS_GetProperty() and JS_HasProperty() in one lookup: returns 1 when the property exists, 0 when not, -1 on exception.
+ * data properties are read from their slot, everything else goes through the API */
+int
+js_get_property_hint(JSContext* ctx, JSValueConst obj, JSAtom atom, uint32_t* slot, JSValue* pval) {
+  JSShapeProperty* prs;
+  JSObject* holder;
+
+  switch(js_shape_lookup(obj, atom, slot, &holder, &prs)) {
+    case 0: {
+      *pval = JS_UNDEFINED;
+      return 0;
+    }
+    case 1: {
+      if((prs->flags & JS_PROP_TMASK) == JS_PROP_NORMAL) {
+        *pval = JS_DupValue(ctx, holder->prop[prs - holder->shape->prop].u.value);
+        return 1;
+      }
+      break;
+    }
+  }
+
+  if(JS_IsException((*pval = JS_GetProperty(ctx, obj, atom))))
+    return -1;
+
+  if(!JS_IsUndefined(*pval))
+    return 1;
+
+  return JS_IsObject(obj) ? JS_HasProperty(ctx, obj, atom) : 0;
+}
+
+/* element 'i' of the typed array 'p', read from its backing store without bounds checking */
+JSValue
+js_typedarray_get(JSContext* ctx, JSObject* p, uint32_t i) {
+  switch(p->class_id) {
+    case JS_CLASS_INT8_ARRAY: return JS_NewInt32(ctx, p->u.array.u.int8_ptr[i]);
+    case JS_CLASS_UINT8C_ARRAY:
+    case JS_CLASS_UINT8_ARRAY: return JS_NewInt32(ctx, p->u.array.u.uint8_ptr[i]);
+    case JS_CLASS_INT16_ARRAY: return JS_NewInt32(ctx, p->u.array.u.int16_ptr[i]);
+    case JS_CLASS_UINT16_ARRAY: return JS_NewInt32(ctx, p->u.array.u.uint16_ptr[i]);
+    case JS_CLASS_INT32_ARRAY: return JS_NewInt32(ctx, p->u.array.u.int32_ptr[i]);
+    case JS_CLASS_UINT32_ARRAY: return JS_NewUint32(ctx, p->u.array.u.uint32_ptr[i]);
+#ifdef CONFIG_BIGNUM
+    case JS_CLASS_BIG_INT64_ARRAY: return JS_NewBigInt64(ctx, p->u.array.u.int64_ptr[i]);
+    case JS_CLASS_BIG_UINT64_ARRAY: return JS_NewBigUint64(ctx, p->u.array.u.uint64_ptr[i]);
+#endif
+    case JS_CLASS_FLOAT32_ARRAY: return __JS_NewFloat64(ctx, p->u.array.u.float_ptr[i]);
+    case JS_CLASS_FLOAT64_ARRAY: return __JS_NewFloat64(ctx, p->u.array.u.double_ptr[i]);
+  }
+  return JS_UNDEFINED;
+}
+
 void
 js_set_propertyint_string(JSContext* ctx, JSValueConst obj, uint32_t i, const char* str) {
   JSValue value;
@@ -1481,6 +1581,19 @@ js_typedarray_constructor(JSContext* ctx) {
   return typedarr_ctor;
 }
 
+JSValue
+js_typedarray_new(JSContext* ctx, const char* class_name, const void* data, size_t size) {
+  JSValue ctor, buffer, ret;
+  buffer = JS_NewArrayBufferCopy(ctx, data, size);
+  if(JS_IsException(buffer))
+    return buffer;
+  ctor = js_global_get(ctx, class_name);
+  ret = JS_CallConstructor(ctx, ctor, 1, &buffer);
+  JS_FreeValue(ctx, ctor);
+  JS_FreeValue(ctx, buffer);
+  return ret;
+}
+
 JSValue
 js_invoke(JSContext* ctx, JSValueConst this_obj, const char* method, int argc, JSValueConst* argv) {
   JSAtom atom;
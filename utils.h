@@ -789,6 +789,10 @@ char* js_get_propertystr_string(JSContext* ctx, JSValueConst obj, const char* pr
 char* js_get_propertystr_stringlen(JSContext* ctx, JSValueConst obj, const char* prop, size_t* lenp);
 int32_t js_get_propertystr_int32(JSContext* ctx, JSValueConst obj, const char* prop);
 uint64_t js_get_propertystr_uint64(JSContext* ctx, JSValueConst obj, const char* prop);
+JSShapeProperty* js_shape_find(JSObject* p, JSAtom atom, uint32_t* slot);
+int js_shape_lookup(JSValueConst obj, JSAtom atom, uint32_t* slot, JSObject** holder, JSShapeProperty** prsp);
+int js_get_property_hint(JSContext* ctx, JSValueConst obj, JSAtom atom, uint32_t* slot, JSValue* pval);
+JSValue js_typedarray_get(JSContext* ctx, JSObject* p, uint32_t i);
 
 static inline void
 js_set_inspect_method(JSContext* ctx, JSValueConst obj, JSCFunction* func) {
@@ -821,6 +825,7 @@ BOOL js_is_typedarray(JSContext* ctx, JSValueConst value);
 
 JSValue js_typedarray_prototype(JSContext* ctx);
 JSValue js_typedarray_constructor(JSContext* ctx);
+JSValue js_typedarray_new(JSContext* ctx, const char* class_name, const void* data, size_t size);
 
 static inline BOOL
 js_is_array(JSContext* ctx, JSValueConst value) {
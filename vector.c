@@ -143,6 +143,7 @@ vector_copy(Vector* dst, const Vector* src) {
   dst->capacity = 0;
   if(!dbuf_realloc(&dst->dbuf, src->size)) {
     memcpy(dst->data, src->data, src->size);
+    dst->size = src->size;
     return 1;
   }
   return 0;